@@ -1,7 +1,9 @@
 #pragma once
 
+#include <eosio/binary_extension.hpp>
 #include <eosio/multi_index.hpp>
 #include <eosio/name.hpp>
+#include <eosio/singleton.hpp>
 #include <eosio/time.hpp>
 
 #include <limits>
@@ -9,30 +11,59 @@
 
 namespace eosiosystem::block_info {
 
-static constexpr uint32_t rolling_window_size = 10;
+/// Default size of the rolling window, the `setblockinfo` action can change it.
+static constexpr uint32_t rolling_window_size     = 10;
+static constexpr uint32_t max_rolling_window_size = 2 * 24 * 3600; // one day of blocks
+
+/// Version of the records written to the blockinfo table since version 3.11.0, see block_info_record.
+static constexpr uint8_t ring_buffer_record_version = 1;
 
 /**
  * The blockinfo table holds a rolling window of records containing information for recent blocks.
  *
  * Each record stores the height and timestamp of the correspond block.
  * A record is added for a new block through the onblock action.
- * The onblock action also erases up to two old records at a time in an attempt to keep the table consisting of only
- * records for blocks going back a particular block height difference backward from the most recent block.
- * Currently that block height difference is hardcoded to 10.
+ *
+ * Since version 3.11.0 the table is a ring buffer of `rolling_window_size` slots: the record of a block is stored in
+ * slot `block_height % rolling_window_size` and overwrites in place the record of the block that fell out of the
+ * rolling window. These records have version 1 and are keyed by slot rather than by block height, so code compiled
+ * against the old layout reports `unsupported_version` instead of misreading them.
+ * Version 0 records keyed by block height are left over from before version 3.11.0 and are all erased by the first
+ * onblock or setblockinfo action after the upgrade. Records in slots past the current window size after the window
+ * shrinks are erased by the onblock action, up to two at a time.
  */
 struct [[eosio::table, eosio::contract("eosio.system")]] block_info_record
 {
    uint8_t           version = 0;
    uint32_t          block_height;
    eosio::time_point block_timestamp;
+   eosio::binary_extension<uint32_t> slot; // added in version 3.11.0
 
-   uint64_t primary_key() const { return block_height; }
+   uint64_t primary_key() const { return slot.has_value() ? slot.value() : block_height; }
 
-   EOSLIB_SERIALIZE(block_info_record, (version)(block_height)(block_timestamp))
+   EOSLIB_SERIALIZE(block_info_record, (version)(block_height)(block_timestamp)(slot))
 };
 
 using block_info_table = eosio::multi_index<"blockinfo"_n, block_info_record>;
 
+/**
+ * The blkinfostate singleton holds the size of the rolling window of the blockinfo table and the height of the latest
+ * block recorded in it, added in version 3.11.0.
+ *
+ * The onblock action updates the latest block height in every block, so that readers compute the slot of the latest
+ * record directly. The singleton has a fixed size, so the update costs no RAM.
+ */
+struct [[eosio::table("blkinfostate"), eosio::contract("eosio.system")]] block_info_state
+{
+   uint8_t  version             = 0;
+   uint32_t rolling_window_size = block_info::rolling_window_size;
+   uint32_t latest_block_height = 0;
+
+   EOSLIB_SERIALIZE(block_info_state, (version)(rolling_window_size)(latest_block_height))
+};
+
+using block_info_state_singleton = eosio::singleton<"blkinfostate"_n, block_info_state>;
+
 struct block_batch_info
 {
    uint32_t          batch_start_height;
@@ -74,7 +105,7 @@ struct latest_block_batch_info_result
  * Note that the range spanning from the start to end block of the latest block batch may be less than batch_size
  * because latest block batch may be incomplete.
  * Also, it is possible for the record capturing info for the starting block to not exist in the blockinfo table. This
- * can either be due to the records being erased as they fall out of the rolling window or, in rare cases, due to gaps
+ * can either be due to the records being overwritten as they fall out of the rolling window or, in rare cases, due to gaps
  * in block info records due to failures of the onblock action. In such a case, this function will be unable to return a
  * `block_batch_info` and will instead be forced to return the `insufficient_data` error code.
  * Furthermore, if `batch_start_height_offset` is greater than the height of the latest block for which
@@ -92,26 +123,53 @@ latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_sta
       return result;
    }
 
+   block_info_state_singleton state_table(system_account_name, 0);
+
+   if (!state_table.exists()) {
+      // Nothing has been recorded in the blockinfo table yet.
+      result.error_code = latest_block_batch_info_result::insufficient_data;
+      return result;
+   }
+
+   const block_info_state state = state_table.get();
+
+   if (state.version != 0) {
+      // Compiled code for this function within the calling contract has not been updated to support new version of
+      // the blkinfostate singleton.
+      result.error_code = latest_block_batch_info_result::unsupported_version;
+      return result;
+   }
+
    block_info_table t(system_account_name, 0);
 
+   // Looks up the record of a block in its slot of the ring buffer. The slot may hold the record of another block
+   // instead, because the rolling window has moved past the requested block, because the window size has changed, or
+   // because of a gap in recording info due to a failed onblock action.
+   auto find_block_info = [&](uint32_t block_height) -> std::optional<block_info_record> {
+      auto itr = t.find(block_height % state.rolling_window_size);
+      if (itr == t.cend() || itr->block_height != block_height) {
+         return {};
+      }
+      return *itr;
+   };
+
    // Find information on latest block recorded in the blockinfo table.
 
-   if (t.cbegin() == t.cend()) {
-      // The blockinfo table is empty.
+   auto latest_block_info = find_block_info(state.latest_block_height);
+
+   if (!latest_block_info) {
       result.error_code = latest_block_batch_info_result::insufficient_data;
       return result;
    }
 
-   auto latest_block_info_itr = --t.cend();
-
-   if (latest_block_info_itr->version != 0) {
+   if (latest_block_info->version != ring_buffer_record_version) {
       // Compiled code for this function within the calling contract has not been updated to support new version of
       // the blockinfo table.
       result.error_code = latest_block_batch_info_result::unsupported_version;
       return result;
    }
 
-   uint32_t latest_block_batch_end_height = latest_block_info_itr->block_height;
+   uint32_t latest_block_batch_end_height = latest_block_info->block_height;
 
    if (latest_block_batch_end_height < batch_start_height_offset) {
       // Caller asking for a block batch that has not even begun to be recorded yet.
@@ -132,29 +190,29 @@ latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_sta
       // another lookup. So shortcut the rest of the process and return a successful result immediately.
       result.result.emplace(block_batch_info{
          .batch_start_height          = latest_block_batch_start_height,
-         .batch_start_timestamp       = latest_block_info_itr->block_timestamp,
+         .batch_start_timestamp       = latest_block_info->block_timestamp,
          .batch_current_end_height    = latest_block_batch_end_height,
-         .batch_current_end_timestamp = latest_block_info_itr->block_timestamp,
+         .batch_current_end_timestamp = latest_block_info->block_timestamp,
       });
       return result;
    }
 
    // Find information on start block of the latest block batch recorded in the blockinfo table.
 
-   auto start_block_info_itr = t.find(latest_block_batch_start_height);
-   if (start_block_info_itr == t.cend() || start_block_info_itr->block_height != latest_block_batch_start_height) {
+   auto start_block_info = find_block_info(latest_block_batch_start_height);
+   if (!start_block_info) {
       // Record for information on start block of the latest block batch could not be found in blockinfo table.
       // This is either because of:
       //    * a gap in recording info due to a failed onblock action;
       //    * a requested start block that was processed by onblock prior to deployment of the system contract code
-      //    introducing the blockinfo table;
-      //    * or, most likely, because the record for the requested start block was pruned from the blockinfo table as
+      //    introducing the blockinfo ring buffer;
+      //    * or, most likely, because the record for the requested start block was overwritten in the ring buffer as
       //    it fell out of the rolling window.
       result.error_code = latest_block_batch_info_result::insufficient_data;
       return result;
    }
 
-   if (start_block_info_itr->version != 0) {
+   if (start_block_info->version != ring_buffer_record_version) {
       // Compiled code for this function within the calling contract has not been updated to support new version of
       // the blockinfo table.
       result.error_code = latest_block_batch_info_result::unsupported_version;
@@ -165,9 +223,9 @@ latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_sta
 
    result.result.emplace(block_batch_info{
       .batch_start_height          = latest_block_batch_start_height,
-      .batch_start_timestamp       = start_block_info_itr->block_timestamp,
+      .batch_start_timestamp       = start_block_info->block_timestamp,
       .batch_current_end_height    = latest_block_batch_end_height,
-      .batch_current_end_timestamp = latest_block_info_itr->block_timestamp,
+      .batch_current_end_timestamp = latest_block_info->block_timestamp,
    });
    return result;
 }
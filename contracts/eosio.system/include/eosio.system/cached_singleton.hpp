@@ -0,0 +1,140 @@
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace eosiosystem {
+
+   /**
+    * Write-back cache of a singleton row.
+    *
+    * The row is read on first access only, and `save` writes it back only if its serialized content differs from
+    * what was read, or if the row does not exist yet. Actions that never touch the state pay for neither the read
+    * nor the write.
+    *
+    * @tparam Singleton - the `eosio::singleton` type holding the row
+    * @tparam T - the type of the row
+    */
+   template<typename Singleton, typename T>
+   class cached_singleton {
+      public:
+         using default_func = T(*)();
+
+         cached_singleton( eosio::name code, uint64_t scope, default_func make_default = nullptr )
+         :_singleton(code, scope), _make_default(make_default) {}
+
+         T& get() {
+            if( !_state ) {
+               if( _singleton.exists() ) {
+                  _state  = _singleton.get();
+                  _stored = eosio::pack( *_state );
+               } else {
+                  _state = _make_default ? _make_default() : T{};
+               }
+            }
+            return *_state;
+         }
+
+         T* operator->() { return &get(); }
+         T& operator*()  { return get(); }
+
+         bool loaded()const { return _state.has_value(); }
+
+         void save( eosio::name payer ) {
+            if( !_state )
+               return;
+
+            auto packed = eosio::pack( *_state );
+            if( _stored && *_stored == packed )
+               return;
+
+            _singleton.set( *_state, payer );
+            _stored = std::move( packed );
+         }
+
+      private:
+         Singleton                        _singleton;
+         default_func                     _make_default;
+         std::optional<T>                 _state;
+         std::optional<std::vector<char>> _stored; ///< serialized row as last read from or written to the database
+   };
+
+   /**
+    * Write-back cache of the row of a single-row `multi_index` table.
+    *
+    * As with `cached_singleton`, the row is read on first access and `save` writes it back only if its serialized
+    * content differs from what was read, so that an action modifying the row several times updates it once.
+    * A row created with `emplace` is written immediately.
+    *
+    * @tparam Table - the `eosio::multi_index` type holding the row
+    * @tparam T - the type of the row
+    */
+   template<typename Table, typename T>
+   class cached_table_row {
+      public:
+         cached_table_row( eosio::name code, uint64_t scope, uint64_t primary_key = 0 )
+         :_table(code, scope), _primary_key(primary_key) {}
+
+         bool exists() {
+            load();
+            return _state.has_value();
+         }
+
+         T& get() {
+            load();
+            eosio::check( _state.has_value(), "unable to find key" );
+            return *_state;
+         }
+
+         T* operator->() { return &get(); }
+         T& operator*()  { return get(); }
+
+         void emplace( eosio::name payer, const T& row ) {
+            _table.emplace( payer, [&]( auto& r ) {
+               r = row;
+            });
+            _loaded = true;
+            _state  = row;
+            _stored = eosio::pack( row );
+         }
+
+         void save() {
+            if( !_state )
+               return;
+
+            auto packed = eosio::pack( *_state );
+            if( _stored && *_stored == packed )
+               return;
+
+            _table.modify( _table.get( _primary_key ), eosio::same_payer, [&]( auto& r ) {
+               r = *_state;
+            });
+            _stored = std::move( packed );
+         }
+
+      private:
+         void load() {
+            if( _loaded )
+               return;
+
+            _loaded = true;
+            if( auto itr = _table.find( _primary_key ); itr != _table.end() ) {
+               _state  = *itr;
+               _stored = eosio::pack( *_state );
+            }
+         }
+
+         Table                            _table;
+         uint64_t                         _primary_key;
+         bool                             _loaded = false;
+         std::optional<T>                 _state;
+         std::optional<std::vector<char>> _stored; ///< serialized row as last read from or written to the database
+   };
+
+} /// namespace eosiosystem
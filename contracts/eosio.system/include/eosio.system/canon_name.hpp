@@ -1,76 +1,46 @@
 #include <eosio.system/eosio.system.hpp>
-#include <cassert>
+#include <eosio.system/canon_name_core.hpp>
+#include <algorithm>
+#include <optional>
 
 namespace eosiosystem {
 
 // -------------------------------------------------------------------------------------------
-struct canon_name_t
+static inline bool name_allowed(name account, name patt)
 {
-   uint64_t _value; // all significant characters are shifted to the least significant position
-   uint64_t _size;  // number of significant characters
-
-   uint64_t mask()  const { return (1ull << (_size * 5)) - 1; }
-   uint64_t size()  const { return _size; }
-   bool     valid() const { return _size != 0; }
-
-   // starts from the end, so n[0] is the last significant character of the name
-   uint64_t operator[](uint64_t i) const { return (_value >> (5 * i)) & 0x1F; }
+   return name_allowed(canon_name_t(account.value), canon_name_t(patt.value));
+}
 
-   canon_name_t(name n) {
-      uint64_t v         = n.value;
-      auto     num_zeros = std::countr_zero(v);
-      if ((num_zeros < 4) || (num_zeros == 64)) { // 13th char must be zero, and pattern should not be empty
-         _size = 0;                               // zero size denotes an invalid pattern
-      } else {
-         uint64_t shift = 4 + ((num_zeros - 4) / 5) * 5;
-         _value         = v >> shift;
-         auto sig_bits  = 64 - shift;
-         _size          = sig_bits / 5;
-      }
-   }
+// same as above, for checking one account name against many patterns
+static inline bool name_allowed(const canon_name_positions& account, name patt)
+{
+   return name_allowed(account, canon_name_t(patt.value));
+}
 
-   // returns true if account_name ends with the same characters as `this`, preceded by a `.` (zero) character
-   bool is_suffix_of(canon_name_t account_name) const {
-      assert(valid());
-      if (size() > account_name.size())
-         return false;
+// -------------------------------------------------------------------------------------------
+// returns a pattern of `group` disallowing `account` (see `name_allowed`), if any
+static inline std::optional<name> find_disallowing_pattern(name account, const denylist_pattern_group& group)
+{
+   canon_name_t account_name(account.value);
+   const uint64_t size = group.size;
 
-      if (((_value ^ account_name._value) & mask()) != 0)
-         return false;
+   if (size == 0 || size > account_name.size())
+      return {};
 
-      // pattern matches the end of account_name. To be a suffix it has to either be the same length (i.e. exact match),
-      // or be preceded by a dot in account_name
-      return (size() == account_name.size()) || (account_name[size()] == 0);
-   }
+   const uint64_t mask   = (1ull << (size * 5)) - 1;
+   const uint64_t suffix = account_name._value & mask;
 
-   bool found_in(canon_name_t account_name) const {
-      assert(valid());
-      if (size() > account_name.size())
-         return false;
+   // a pattern which is a suffix of account_name, preceded by a dot, does not disallow it
+   const bool exempt_suffix = (size == account_name.size()) || (account_name[size] == 0);
 
-      auto   sz   = size();
-      size_t diff = account_name.size() - sz + 1;
-      for (size_t i = 0; i < diff; ++i)
-         if (((_value ^ (account_name._value >> (5 * i))) & mask()) == 0)
-            return true;
-      return false;
+   for (uint64_t i = 0; i + size <= account_name.size(); ++i) {
+      uint64_t window = (account_name._value >> (5 * i)) & mask;
+      if (exempt_suffix && window == suffix)
+         continue;
+      if (std::binary_search(group.values.cbegin(), group.values.cend(), window))
+         return name{window << (64 - 5 * size)};
    }
-};
-
-// -------------------------------------------------------------------------------------------
-static inline bool name_allowed(name account, name patt)
-{
-   canon_name_t pattern(patt);
-   canon_name_t account_name(account);
-
-   if (!pattern.valid())
-      return true; // ignore invalid patterns
-
-   if (pattern.is_suffix_of(account_name))
-      return true;
-   if (pattern.found_in(account_name))
-      return false;
-   return true;
+   return {};
 }
 
 } // namespace eosiosystem
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+
+namespace eosiosystem {
+
+// Account names and denylist patterns as sequences of 5-bit characters. This header has no dependency on the contract
+// library so that native tools and tests can include it.
+
+// -------------------------------------------------------------------------------------------
+struct canon_name_t
+{
+   uint64_t _value; // all significant characters are shifted to the least significant position
+   uint64_t _size;  // number of significant characters
+
+   uint64_t mask()  const { return (1ull << (_size * 5)) - 1; }
+   uint64_t size()  const { return _size; }
+   bool     valid() const { return _size != 0; }
+
+   // starts from the end, so n[0] is the last significant character of the name
+   uint64_t operator[](uint64_t i) const { return (_value >> (5 * i)) & 0x1F; }
+
+   explicit canon_name_t(uint64_t v) {
+      auto num_zeros = std::countr_zero(v);
+      if ((num_zeros < 4) || (num_zeros == 64)) { // 13th char must be zero, and pattern should not be empty
+         _value = 0;
+         _size  = 0;                              // zero size denotes an invalid pattern
+      } else {
+         uint64_t shift = 4 + ((num_zeros - 4) / 5) * 5;
+         _value         = v >> shift;
+         auto sig_bits  = 64 - shift;
+         _size          = sig_bits / 5;
+      }
+   }
+
+   // returns true if account_name ends with the same characters as `this`, preceded by a `.` (zero) character
+   bool is_suffix_of(canon_name_t account_name) const {
+      assert(valid());
+      if (size() > account_name.size())
+         return false;
+
+      if (((_value ^ account_name._value) & mask()) != 0)
+         return false;
+
+      // pattern matches the end of account_name. To be a suffix it has to either be the same length (i.e. exact match),
+      // or be preceded by a dot in account_name
+      return (size() == account_name.size()) || (account_name[size()] == 0);
+   }
+
+   // SWAR helpers, operating on the twelve 5-bit characters of a name as lanes of a 64-bit word
+   static constexpr uint64_t lane_ones = 0x0084210842108421ull; // 1 in each lane
+   static constexpr uint64_t lane_low  = lane_ones * 0x0F;      // 4 low bits of each lane
+   static constexpr uint64_t lane_high = lane_ones << 4;        // high bit of each lane
+
+   // returns a word with the high bit of lane i set if the character at position i is `c`, for all 12 lanes
+   // (characters past size() are zero)
+   uint64_t positions_of(uint64_t c) const {
+      uint64_t x = _value ^ (c * lane_ones);                 // lanes holding `c` are now zero
+      uint64_t y = (x & lane_low) + lane_low;                // high bit set if the 4 low bits are not all zero
+      return ~(y | x) & lane_high;                           // high bit set only for zero lanes
+   }
+
+   // returns a word with the high bit of lane i set for every position i where a pattern of `sz` characters fits
+   uint64_t window_starts(uint64_t sz) const {
+      return lane_high & ((1ull << (5 * (size() - sz + 1))) - 1);
+   }
+
+   // returns true if `this` occurs at any position of account_name. All positions are compared at once: a pattern
+   // starts at position i if character j of the pattern is at position i + j of account_name, for every j.
+   bool found_in(canon_name_t account_name) const {
+      assert(valid());
+      if (size() > account_name.size())
+         return false;
+
+      uint64_t starts = account_name.window_starts(size());
+      for (uint64_t j = 0; j < size() && starts; ++j)
+         starts &= account_name.positions_of((*this)[j]) >> (5 * j);
+      return starts != 0;
+   }
+};
+
+// -------------------------------------------------------------------------------------------
+// Positions of every possible character in an account name, computed once to check the account name against many
+// patterns: each pattern then costs one `and` per character instead of one comparison per position.
+struct canon_name_positions
+{
+   canon_name_t             account_name;
+   std::array<uint64_t, 32> positions; // positions[c] is `account_name.positions_of(c)`
+
+   explicit canon_name_positions(canon_name_t n) : account_name(n) {
+      for (uint64_t c = 0; c < positions.size(); ++c)
+         positions[c] = account_name.positions_of(c);
+   }
+
+   // same as `pattern.found_in(account_name)`
+   bool contains(canon_name_t pattern) const {
+      assert(pattern.valid());
+      if (pattern.size() > account_name.size())
+         return false;
+
+      uint64_t starts = account_name.window_starts(pattern.size());
+      for (uint64_t j = 0; j < pattern.size() && starts; ++j)
+         starts &= positions[pattern[j]] >> (5 * j);
+      return starts != 0;
+   }
+};
+
+// -------------------------------------------------------------------------------------------
+// returns false if `pattern` occurs in `account_name`, unless it is a suffix of `account_name` preceded by a dot
+inline bool name_allowed(canon_name_t account_name, canon_name_t pattern)
+{
+   if (!pattern.valid())
+      return true; // ignore invalid patterns
+
+   if (pattern.is_suffix_of(account_name))
+      return true;
+   if (pattern.found_in(account_name))
+      return false;
+   return true;
+}
+
+// same as above, for checking one account name against many patterns
+inline bool name_allowed(const canon_name_positions& account, canon_name_t pattern)
+{
+   if (!pattern.valid())
+      return true; // ignore invalid patterns
+
+   if (pattern.is_suffix_of(account.account_name))
+      return true;
+   if (account.contains(pattern))
+      return false;
+   return true;
+}
+
+} // namespace eosiosystem
@@ -9,6 +9,7 @@
 #include <eosio/time.hpp>
 #include <eosio/instant_finality.hpp>
 
+#include <eosio.system/cached_singleton.hpp>
 #include <eosio.system/exchange_state.hpp>
 #include <eosio.system/native.hpp>
 
@@ -76,6 +77,10 @@ namespace eosiosystem {
    static constexpr int64_t  min_pervote_daily_pay = 100'0000;
    static constexpr uint32_t refund_delay_sec      = 3 * seconds_per_day;
 
+   // Changes to the vote weight of a proxy are only propagated to its producers once they exceed this fraction of the
+   // proxy's last propagated vote weight, when the proxy updates its own vote or registration, or on `proxyupdate`.
+   static constexpr double   proxy_weight_propagation_threshold = 0.001;
+
    static constexpr int64_t  inflation_precision           = 100;     // 2 decimals
    static constexpr int64_t  default_annual_rate           = 500;     // 5% annual rate
    static constexpr int64_t  pay_factor_precision          = 10000;
@@ -179,8 +184,21 @@ namespace eosiosystem {
       double            total_producer_votepay_share = 0;
       uint8_t           revision = 0; ///< used to track version updates in the future.
 
+      // true while no data relevant to the producer ranking (votes, producer registration, finalizer keys) has changed
+      // since the last producer schedule update, added in version 3.11.0. Stored inverted so that a missing value
+      // means the ranking has to be evaluated.
+      eosio::binary_extension<bool>                producer_ranking_unchanged;
+      // hash of the last producer schedule successfully proposed, added in version 3.11.0. All zeros when no schedule
+      // was proposed since the upgrade.
+      eosio::binary_extension<eosio::checksum256>  last_proposed_producers_hash;
+      // bounds of the votes of the producers elected (at least `lowest_elected_votes`) and left out (at most
+      // `highest_unelected_votes`) at the last producer schedule update, added in version 3.11.0
+      eosio::binary_extension<double>              lowest_elected_votes;
+      eosio::binary_extension<double>              highest_unelected_votes;
+
       EOSLIB_SERIALIZE( eosio_global_state2, (new_ram_per_block)(last_ram_increase)(last_block_num)
-                        (total_producer_votepay_share)(revision) )
+                        (total_producer_votepay_share)(revision)(producer_ranking_unchanged)(last_proposed_producers_hash)
+                        (lowest_elected_votes)(highest_unelected_votes) )
    };
 
    // Defines new global state parameters added after version 1.3.0
@@ -202,6 +220,17 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( eosio_global_state4, (continuous_rate)(inflation_pay_factor)(votepay_factor) )
    };
 
+   // Compact summary of the system state read by helpers used on every account creation and by other system
+   // contracts, added in version 3.11.0. It is written by `init` and whenever the REX pool becomes available or
+   // empty, so that reading it is cheaper than looking up the `rammarket` and `rexpool` tables.
+   struct [[eosio::table("sysstatus"), eosio::contract("eosio.system")]] system_status {
+      symbol   core_symbol;
+      bool     rex_initialized = false; // the REX pool exists
+      bool     rex_available   = false; // the REX pool exists and holds REX
+
+      EOSLIB_SERIALIZE( system_status, (core_symbol)(rex_initialized)(rex_available) )
+   };
+
    // Defines the schedule for pre-determined annual rate changes.
    struct [[eosio::table, eosio::contract("eosio.system")]] schedules_info {
       time_point_sec start_time;
@@ -217,6 +246,24 @@ namespace eosiosystem {
       return eosio::block_signing_authority_v0{ .threshold = 1, .keys = {{producer_key, 1}} };
    }
 
+   // Defines the votepay share accrued by a producer, stored within the `producer_info` row so that it is settled in the
+   // same write that updates the producer's `total_votes`, added in version 3.11.0 (replaces `producer_info2`)
+   struct producer_votepay_state {
+      double          votepay_share = 0;
+      time_point      last_votepay_share_update;
+
+      // returns the votepay share accrued up to `ct` at a rate of `shares_rate` shares per second
+      double accrued_votepay_share( const time_point& ct, double shares_rate )const {
+         if( shares_rate > 0.0 && ct > last_votepay_share_update ) {
+            return votepay_share + shares_rate * double( (ct - last_votepay_share_update).count() / 1E6 );
+         }
+         return votepay_share;
+      }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE( producer_votepay_state, (votepay_share)(last_votepay_share_update) )
+   };
+
    // Defines `producer_info` structure to be stored in `producer_info` table, added after version 1.0
    struct [[eosio::table, eosio::contract("eosio.system")]] producer_info {
       name                                                     owner;
@@ -228,6 +275,7 @@ namespace eosiosystem {
       time_point                                               last_claim_time;
       uint16_t                                                 location = 0;
       eosio::binary_extension<eosio::block_signing_authority>  producer_authority; // added in version 1.9.0
+      eosio::binary_extension<producer_votepay_state>          votepay_state; // added in version 3.11.0
 
       uint64_t primary_key()const { return owner.value;                             }
       double   by_votes()const    { return is_active ? -total_votes : total_votes;  }
@@ -255,6 +303,8 @@ namespace eosiosystem {
       // way and increasing its serialized size is not acceptable in that context.
       // So, a custom serialization is defined to handle the binary_extension producer_authority
       // field in the desired way. (Note: v1.9.0 did not have this custom serialization behavior.)
+      // The votepay_state field follows producer_authority, so when a deactivated producer has no producer_authority a
+      // default constructed one (zero threshold) is written in its place, which get_producer_authority() ignores.
 
       template<typename DataStream>
       friend DataStream& operator << ( DataStream& ds, const producer_info& t ) {
@@ -267,9 +317,16 @@ namespace eosiosystem {
             << t.last_claim_time
             << t.location;
 
-         if( !t.producer_authority.has_value() ) return ds;
+         if( !t.producer_authority.has_value() && !t.votepay_state.has_value() ) return ds;
 
-         return ds << t.producer_authority;
+         if( t.producer_authority.has_value() )
+            ds << t.producer_authority;
+         else
+            ds << eosio::block_signing_authority{};
+
+         if( !t.votepay_state.has_value() ) return ds;
+
+         return ds << t.votepay_state;
       }
 
       template<typename DataStream>
@@ -282,11 +339,13 @@ namespace eosiosystem {
                    >> t.unpaid_blocks
                    >> t.last_claim_time
                    >> t.location
-                   >> t.producer_authority;
+                   >> t.producer_authority
+                   >> t.votepay_state;
       }
    };
 
    // Defines new producer info structure to be stored in new producer info table, added after version 1.3.0
+   // Superseded by `producer_info::votepay_state`; rows are migrated when the producer registers or claims rewards.
    struct [[eosio::table, eosio::contract("eosio.system")]] producer_info2 {
       name            owner;
       double          votepay_share = 0;
@@ -298,6 +357,19 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( producer_info2, (owner)(votepay_share)(last_votepay_share_update) )
    };
 
+   // Blocks produced by a producer since they were last flushed into its producers row, added in version 3.11.0.
+   // onblock increments this small row instead of rewriting the producers row on every block. Counts are flushed
+   // into `producer_info::unpaid_blocks` and `eosio_global_state::total_unpaid_blocks` at every producer schedule
+   // update and before rewards are claimed, which leaves the row in place with a zero count.
+   struct [[eosio::table, eosio::contract("eosio.system")]] unpaid_blocks_counter {
+      name            owner;
+      uint32_t        unpaid_blocks = 0;
+
+      uint64_t primary_key()const { return owner.value; }
+
+      EOSLIB_SERIALIZE( unpaid_blocks_counter, (owner)(unpaid_blocks) )
+   };
+
    // finalizer_key_info stores information about a finalizer key.
    struct [[eosio::table("finkeys"), eosio::contract("eosio.system")]] finalizer_key_info {
       uint64_t          id;                   // automatically generated ID for the key in the table
@@ -379,6 +451,8 @@ namespace eosiosystem {
    // A single entry storing a vector of names, each of which is a pattern that new account names
    // are checked against (when the `newaccount` is called), in order to reject the creation
    // of accounts whose name matches patterns in the blacklist.
+   // Since version 3.11.0 the patterns are stored in the `denylist_shard_table` instead, and this entry is only
+   // read until its patterns have been moved there.
    struct [[eosio::table("acctdenylist"), eosio::contract("eosio.system")]] account_name_blacklist {
       std::vector<name> disallowed;
 
@@ -389,6 +463,22 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "acctdenylist"_n, account_name_blacklist >  account_name_blacklist_table;
 
+   // Patterns of the account name denylist which have the same number of significant characters, added in version
+   // 3.11.0. The denylist is sharded into one row per pattern size, so `newaccount` only reads the rows whose patterns
+   // are short enough to occur in the new account name, and `denynames` / `undenynames` only rewrite the rows of the
+   // pattern sizes they touch. Patterns still stored in the legacy `account_name_blacklist` are moved into this table
+   // the next time `denynames` or `undenynames` is called.
+   struct [[eosio::table("acctdenyshrd"), eosio::contract("eosio.system")]] denylist_pattern_group {
+      uint8_t                size;   // number of significant characters of the patterns
+      std::vector<uint64_t>  values; // sorted significant characters of the patterns, as in `canon_name_t`
+
+      uint64_t primary_key() const { return size; }
+
+      EOSLIB_SERIALIZE( denylist_pattern_group, (size)(values) )
+   };
+
+   typedef eosio::multi_index< "acctdenyshrd"_n, denylist_pattern_group >  denylist_shard_table;
+
    // Store hash values allowing account blacklist names to be added to `account_name_blacklist_table`
    struct [[eosio::table("acctdenyhash"), eosio::contract("eosio.system")]] deny_hash {
       uint64_t     id;                       // automatically generated ID for the key in the table
@@ -449,6 +539,8 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "producers2"_n, producer_info2 > producers_table2;
 
+   typedef eosio::multi_index< "unpaidblocks"_n, unpaid_blocks_counter > unpaid_blocks_table;
+
    typedef eosio::multi_index< "schedules"_n, schedules_info > schedules_table;
 
    typedef eosio::singleton< "global"_n, eosio_global_state >   global_state_singleton;
@@ -459,6 +551,16 @@ namespace eosiosystem {
 
    typedef eosio::singleton< "global4"_n, eosio_global_state4 > global_state4_singleton;
 
+   typedef eosio::singleton< "sysstatus"_n, system_status > system_status_singleton;
+
+   typedef cached_singleton< global_state_singleton, eosio_global_state >   global_state_cache;
+
+   typedef cached_singleton< global_state2_singleton, eosio_global_state2 > global_state2_cache;
+
+   typedef cached_singleton< global_state3_singleton, eosio_global_state3 > global_state3_cache;
+
+   typedef cached_singleton< global_state4_singleton, eosio_global_state4 > global_state4_cache;
+
    struct [[eosio::table, eosio::contract("eosio.system")]] user_resources {
       name          owner;
       asset         net_weight;
@@ -543,6 +645,8 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "rexpool"_n, rex_pool > rex_pool_table;
 
+   typedef cached_table_row< rex_pool_table, rex_pool > rex_pool_cache;
+
    // `rex_return_pool` structure underlying the rex return pool table. A rex return pool table entry is defined by:
    // - `version` defaulted to zero,
    // - `last_dist_time` the last time proceeds from renting, ram fees, and name bids were added to the rex pool,
@@ -570,6 +674,8 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "rexretpool"_n, rex_return_pool > rex_return_pool_table;
 
+   typedef cached_table_row< rex_return_pool_table, rex_return_pool > rex_return_pool_cache;
+
    struct pair_time_point_sec_int64 {
       time_point_sec first;
       int64_t        second;
@@ -589,6 +695,28 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "retbuckets"_n, rex_return_buckets > rex_return_buckets_table;
 
+   // `rex_return_ring` structure underlying the rex return ring table, added in version 3.11.0 to replace the
+   // `rex_return_buckets` table, whose row is migrated on first use. A rex return ring table entry is defined by:
+   // - `version` defaulted to zero,
+   // - `buckets` one slot for each 12-hour return bucket of the 30-day distribution window. The bucket of time `t`
+   //    is stored in slot `slot(t)`, and the `first` field of an empty slot is zero. The row size is constant.
+   struct [[eosio::table,eosio::contract("eosio.system")]] rex_return_ring {
+      static constexpr uint32_t bucket_interval = rex_return_pool::hours_per_bucket * seconds_per_hour;
+      static constexpr uint32_t num_buckets     = rex_return_pool::total_intervals * rex_return_pool::dist_interval / bucket_interval;
+      static_assert( num_buckets * bucket_interval == 30 * seconds_per_day );
+
+      uint8_t                                version = 0;
+      std::vector<pair_time_point_sec_int64> buckets = std::vector<pair_time_point_sec_int64>( num_buckets );
+
+      static uint32_t slot( const time_point_sec& t ) { return ( t.sec_since_epoch() / bucket_interval ) % num_buckets; }
+
+      uint64_t primary_key()const { return 0; }
+   };
+
+   typedef eosio::multi_index< "retring"_n, rex_return_ring > rex_return_ring_table;
+
+   typedef cached_table_row< rex_return_ring_table, rex_return_ring > rex_return_ring_cache;
+
    // `rex_fund` structure underlying the rex fund table. A rex fund table entry is defined by:
    // - `version` defaulted to zero,
    // - `owner` the owner of the rex fund,
@@ -603,12 +731,31 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "rexfund"_n, rex_fund > rex_fund_table;
 
+   // Maturity buckets of a version 1 `rex_balance`, added in version 3.11.0. Buckets are indexed by day, so that their
+   // number does not depend on how often the owner buys REX:
+   // - `base_day` the day, counted from the epoch, up to which maturities have been processed,
+   // - `savings` REX in savings, which never matures,
+   // - `maturing` REX maturing at the start of each day following `base_day`, one entry per day of the maturity period.
+   struct rex_maturity_days {
+      uint32_t             base_day = 0;
+      int64_t              savings  = 0;
+      std::vector<int64_t> maturing;
+
+      static uint32_t day_of( const time_point_sec& t ) { return t.sec_since_epoch() / seconds_per_day; }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE( rex_maturity_days, (base_day)(savings)(maturing) )
+   };
+
    // `rex_balance` structure underlying the rex balance table. A rex balance table entry is defined by:
-   // - `version` defaulted to zero,
+   // - `version` 0 if maturities are held in `rex_maturities`, 1 if they are held in `maturity_days`,
    // - `owner` the owner of the rex fund,
    // - `vote_stake` the amount of CORE_SYMBOL currently included in owner's vote,
    // - `rex_balance` the amount of REX owned by owner,
-   // - `matured_rex` matured REX available for selling
+   // - `matured_rex` matured REX available for selling,
+   // - `rex_maturities` REX daily maturity buckets, the savings bucket last, version 0 only,
+   // - `maturity_days` REX maturity buckets indexed by day, version 1 only.
+   // Version 0 balances are converted to version 1 by `process_maturities`.
    struct [[eosio::table,eosio::contract("eosio.system")]] rex_balance {
       uint8_t version = 0;
       name    owner;
@@ -616,8 +763,14 @@ namespace eosiosystem {
       asset   rex_balance;
       int64_t matured_rex = 0;
       std::vector<pair_time_point_sec_int64> rex_maturities; /// REX daily maturity buckets
+      eosio::binary_extension<rex_maturity_days> maturity_days; // added in version 3.11.0
 
       uint64_t primary_key()const { return owner.value; }
+
+      // converts a version 0 balance to version 1 and moves REX maturing up to the start of `day` to `matured_rex`
+      void process_maturities( uint32_t day );
+      // adds `rex` maturing at the start of `day`, which must follow the day maturities were processed up to
+      void add_maturing_rex( uint32_t day, int64_t rex );
    };
 
    typedef eosio::multi_index< "rexbal"_n, rex_balance > rex_balance_table;
@@ -682,6 +835,27 @@ namespace eosiosystem {
 
    typedef eosio::singleton<"rexmaturity"_n, rex_maturity> rex_maturity_singleton;
 
+   // `rex_maintenance` structure underlying the REX maintenance singleton, added in version 3.11.0:
+   // - `version` defaulted to zero,
+   // - `next_due` time before which no REX maintenance is due: no loan expires, no sellrex order is queued
+   //    and no returns are distributed to the rex pool,
+   // - `budget_block` block in which REX actions last processed loans and sellrex orders,
+   // - `budget_used` number of loans and sellrex orders processed by REX actions in `budget_block`
+   struct [[eosio::table("rexmaint"),eosio::contract("eosio.system")]] rex_maintenance {
+      uint8_t          version = 0;
+      time_point_sec   next_due;
+      block_timestamp  budget_block;
+      uint16_t         budget_used = 0;
+
+      static constexpr uint16_t block_budget = 12; // loans and sellrex orders processed per block by REX actions
+
+      EOSLIB_SERIALIZE( rex_maintenance, (version)(next_due)(budget_block)(budget_used) )
+   };
+
+   typedef eosio::singleton<"rexmaint"_n, rex_maintenance> rex_maintenance_singleton;
+
+   typedef cached_singleton< rex_maintenance_singleton, rex_maintenance > rex_maintenance_cache;
+
    struct rex_order_outcome {
       bool success;
       asset proceeds;
@@ -798,6 +972,21 @@ namespace eosiosystem {
       time_point_sec utilization_timestamp   = {};                 // When adjusted_utilization was last updated
    };
 
+   // Fixed-point form of the exponent of a resource market price curve, precomputed by `cfgpowerup`
+   struct powerup_price_curve {
+      uint32_t             exponent_integer  = 0;  // integer part of the exponent
+      uint64_t             exponent_fraction = 0;  // fractional part of the exponent, in units of 2^-60
+
+      static powerup_price_curve from_exponent( double exponent ) {
+         powerup_price_curve curve;
+         curve.exponent_integer  = uint32_t(exponent);
+         curve.exponent_fraction = uint64_t((exponent - curve.exponent_integer) * double(uint64_t(1) << 60));
+         return curve;
+      }
+
+      EOSLIB_SERIALIZE( powerup_price_curve, (exponent_integer)(exponent_fraction) )
+   };
+
    struct [[eosio::table("powup.state"),eosio::contract("eosio.system")]] powerup_state {
       static constexpr uint32_t default_powerup_days = 30; // 30 day resource powerup
 
@@ -806,12 +995,23 @@ namespace eosiosystem {
       powerup_state_resource     cpu               = {};                     // CPU market state
       uint32_t                   powerup_days      = default_powerup_days;   // `powerup` `days` argument must match this.
       asset                      min_powerup_fee   = {};                     // fees below this amount are rejected
+      binary_extension<powerup_price_curve> net_curve;                       // added in version 3.11.0
+      binary_extension<powerup_price_curve> cpu_curve;                       // added in version 3.11.0
 
       uint64_t primary_key()const { return 0; }
+
+      // Price curves of a state configured before version 3.11.0 are derived from the exponents
+      powerup_price_curve get_net_curve()const {
+         return net_curve.has_value() ? *net_curve : powerup_price_curve::from_exponent( net.exponent );
+      }
+      powerup_price_curve get_cpu_curve()const {
+         return cpu_curve.has_value() ? *cpu_curve : powerup_price_curve::from_exponent( cpu.exponent );
+      }
    };
 
    typedef eosio::singleton<"powup.state"_n, powerup_state> powerup_state_singleton;
 
+   // Powerup orders placed before version 3.11.0. No longer written, see `powerup_expiry_bucket`
    struct [[eosio::table("powup.order"),eosio::contract("eosio.system")]] powerup_order {
       uint8_t              version = 0;
       uint64_t             id;
@@ -830,6 +1030,45 @@ namespace eosiosystem {
                                indexed_by<"byexpires"_n, const_mem_fun<powerup_order, uint64_t, &powerup_order::by_expires>>
                                > powerup_order_table;
 
+   // Powerup orders expiring at `expires`, added in version 3.11.0 to replace `powerup_order` rows. An order expires at
+   // the end of the hour in which its `days` elapse, so all orders placed within the same hour share a bucket. The
+   // primary key orders the buckets by expiry, so the queue is processed without a secondary index. The orders of a
+   // bucket are kept in `powup.entry` rows scoped by `expires`. Orders placed before 3.11.0 stay in `powup.order`
+   // until they expire.
+   struct [[eosio::table("powup.bucket"),eosio::contract("eosio.system")]] powerup_expiry_bucket {
+      static constexpr uint32_t bucket_interval = seconds_per_hour;
+
+      uint8_t              version = 0;
+      time_point_sec       expires;
+
+      uint64_t primary_key()const { return expires.utc_seconds; }
+   };
+
+   typedef eosio::multi_index< "powup.bucket"_n, powerup_expiry_bucket > powerup_bucket_table;
+
+   // Resources of the powerup orders of a single owner in a bucket, summed. Scoped by the bucket `expires`.
+   struct [[eosio::table("powup.entry"),eosio::contract("eosio.system")]] powerup_bucket_entry {
+      uint8_t              version = 0;
+      name                 owner;
+      int64_t              net_weight;
+      int64_t              cpu_weight;
+
+      uint64_t primary_key()const { return owner.value; }
+   };
+
+   typedef eosio::multi_index< "powup.entry"_n, powerup_bucket_entry > powerup_entry_table;
+
+   // Result of `powerupquote`
+   struct powerup_quote {
+      asset                fee;                    // fee `powerup` would charge
+      int64_t              net_amount      = 0;    // NET weight `powerup` would reserve
+      int64_t              cpu_amount      = 0;    // CPU weight `powerup` would reserve
+      int64_t              net_utilization = 0;    // NET market utilization after the powerup
+      int64_t              cpu_utilization = 0;    // CPU market utilization after the powerup
+
+      EOSLIB_SERIALIZE( powerup_quote, (fee)(net_amount)(cpu_amount)(net_utilization)(cpu_utilization) )
+   };
+
    /**
     * The `eosio.system` smart contract defines the structures and actions needed for blockchain's core functionality.
     *
@@ -854,28 +1093,27 @@ namespace eosiosystem {
          voters_table             _voters;
          producers_table          _producers;
          producers_table2         _producers2;
+         unpaid_blocks_table      _unpaid_blocks;
          finalizer_keys_table     _finalizer_keys;
          finalizers_table         _finalizers;
          last_prop_fins_table     _last_prop_finalizers;
          std::optional<std::vector<finalizer_auth_info>> _last_prop_finalizers_cached;
          fin_key_id_gen_table     _fin_key_id_generator;
-         global_state_singleton   _global;
-         global_state2_singleton  _global2;
-         global_state3_singleton  _global3;
-         global_state4_singleton  _global4;
-         eosio_global_state       _gstate;
-         eosio_global_state2      _gstate2;
-         eosio_global_state3      _gstate3;
-         eosio_global_state4      _gstate4;
+         global_state_cache       _gstate;
+         global_state2_cache      _gstate2;
+         global_state3_cache      _gstate3;
+         global_state4_cache      _gstate4;
          schedules_table          _schedules;
          rammarket                _rammarket;
-         rex_pool_table           _rexpool;
-         rex_return_pool_table    _rexretpool;
+         rex_pool_cache           _rexpool;
+         rex_return_pool_cache    _rexretpool;
          rex_return_buckets_table _rexretbuckets;
+         rex_return_ring_cache    _rexretring;
          rex_fund_table           _rexfunds;
          rex_balance_table        _rexbalance;
          rex_order_table          _rexorders;
          rex_maturity_singleton   _rexmaturity;
+         rex_maintenance_cache    _rexmaint;
 
       public:
          static constexpr eosio::name active_permission{"active"_n};
@@ -902,6 +1140,10 @@ namespace eosiosystem {
           // Returns the core symbol by system account name
           // @param system_account - the system account to get the core symbol for.
          static symbol get_core_symbol( name system_account = "eosio"_n ) {
+            system_status_singleton status(system_account, system_account.value);
+            if ( status.exists() )
+               return status.get().core_symbol;
+
             rammarket rm(system_account, system_account.value);
             auto itr = rm.find(ramcore_symbol.raw());
             check(itr != rm.end(), "system contract must first be initialized");
@@ -909,15 +1151,27 @@ namespace eosiosystem {
          }
 
          // Returns true/false if the rex system is initialized
+         // Reads the committed state: actions of the system contract use `rex_pool_initialized` instead, since the
+         // `_rexpool` cache may hold changes that neither the REX pool row nor the system status reflect yet.
          static bool rex_system_initialized( name system_account = "eosio"_n ) {
+            system_status_singleton status(system_account, system_account.value);
+            if ( status.exists() )
+               return status.get().rex_initialized;
+
             eosiosystem::rex_pool_table _rexpool( system_account, system_account.value );
             return _rexpool.begin() != _rexpool.end();
          }
 
          // Returns true/false if the rex system is available
+         // Reads the committed state: actions of the system contract use `rex_pool_available` instead.
          static bool rex_available( name system_account = "eosio"_n ) {
+            system_status_singleton status(system_account, system_account.value);
+            if ( status.exists() )
+               return status.get().rex_available;
+
             eosiosystem::rex_pool_table _rexpool( system_account, system_account.value );
-            return rex_system_initialized() && _rexpool.begin()->total_rex.amount > 0;
+            auto itr = _rexpool.begin();
+            return itr != _rexpool.end() && itr->total_rex.amount > 0;
          }
 
          // Actions:
@@ -1000,7 +1254,7 @@ namespace eosiosystem {
           *
           * Once this hash has been stored in the blockchain (a privileged operation), any account can call the
           * `denynames` action to add the vector of name patterns that this hash was computed from to the
-          * `account_name_blacklist`.
+          * account name denylist.
           *
           * requires "eosio"_n permission
           *
@@ -1022,9 +1276,9 @@ namespace eosiosystem {
          void denyhashrm( const checksum256& hash );
 
          /**
-          * Add names to the `account_name_blacklist` singleton.
+          * Add names to the account name denylist, stored in the `denylist_shard_table`.
           *
-          * The `account_name_blacklist` singleton contains a vector of names, each of which is a pattern that
+          * The denylist contains names, each of which is a pattern that
           * new account names are checked against (when the `newaccount` is called), in order to reject the creation
           * of accounts whose name includes patterns in the blacklist.
           * The "eosio"_n account is not subject to the blacklist restrictions.
@@ -1038,9 +1292,9 @@ namespace eosiosystem {
          void denynames( const std::vector<name>& patterns );
 
          /**
-          * Remove names from the `account_name_blacklist` singleton.
+          * Remove names from the account name denylist, stored in the `denylist_shard_table`.
           *
-          * The `account_name_blacklist` singleton contains a vector of names, each of which is a pattern that
+          * The denylist contains names, each of which is a pattern that
           * new account names are checked against (when the `newaccount` is called), in order to reject the creation
           * of accounts whose name includes patterns in the blacklist.
           * The "eosio"_n account is not subject to the blacklist restrictions.
@@ -1268,6 +1522,8 @@ namespace eosiosystem {
          /**
           * Rexexec action, processes max CPU loans, max NET loans, and max queued sellrex orders.
           * Action does not execute anything related to a specific user.
+          * Other REX actions only perform maintenance once it is due, and process a limited number of loans and
+          * sellrex orders per block; `rexexec` is not subject to this limit and can be used to drain the backlog.
           *
           * @param user - any account can execute this action,
           * @param max - number of each of CPU loans, NET loans, and sell orders to be processed.
@@ -1275,6 +1531,16 @@ namespace eosiosystem {
          [[eosio::action]]
          void rexexec( const name& user, uint16_t max );
 
+         /**
+          * Rexsettle action, settles and deletes up to max filled sellrex orders. The proceeds and stake change of each
+          * order are credited to its owner as `updaterex` would, so that the queue only holds open orders.
+          *
+          * @param user - any account can execute this action,
+          * @param max - number of filled sell orders to be settled.
+          */
+         [[eosio::action]]
+         void rexsettle( const name& user, uint16_t max );
+
          /**
           * Consolidate action, consolidates REX maturity buckets into one bucket that can be sold after {num_of_maturity_buckets} days
           * starting from the end of the day.
@@ -1678,6 +1944,15 @@ namespace eosiosystem {
          [[eosio::action]]
          void setramrate( uint16_t bytes_per_block );
 
+         /**
+          * Set block info action, sets the size of the rolling window of recent blocks kept in the blockinfo table.
+          * When the window shrinks, the records that no longer fit are erased by onblock, up to two per block.
+          *
+          * @param rolling_window_size - the number of recent blocks to keep, between 1 and one day of blocks.
+          */
+         [[eosio::action]]
+         void setblockinfo( uint32_t rolling_window_size );
+
          /**
           * Vote producer action, votes for a set of producers. This action updates the list of `producers` voted for,
           * for `voter` account. If voting for a `proxy`, the producer votes will not change until the
@@ -1733,6 +2008,18 @@ namespace eosiosystem {
          [[eosio::action]]
          void regproxy( const name& proxy, bool isproxy );
 
+         /**
+          * Proxy update action, applies the pending vote weight change of `proxy` to the producers it votes for.
+          * Changes to the weight of the accounts using a proxy are only applied to its producers once they exceed a
+          * fraction of its vote weight (see `proxy_weight_propagation_threshold`). Any account can execute this action.
+          *
+          * @param proxy - the proxy account whose pending vote weight change is applied.
+          *
+          * @pre `proxy` must be registered as a proxy
+          */
+         [[eosio::action]]
+         void proxyupdate( const name& proxy );
+
          /**
           * Set the blockchain parameters. By tunning these parameters a degree of
           * customization can be achieved.
@@ -1895,7 +2182,8 @@ namespace eosiosystem {
           * Process power queue and update state. Action does not execute anything related to a specific user.
           *
           * @param user - any account can execute this action
-          * @param max - number of queue items to process
+          * @param max - number of expired queue items to process. The orders of a receiver expiring in the same
+          *    bucket form a single item.
           */
          [[eosio::action]]
          void powerupexec( const name& user, uint16_t max );
@@ -1905,7 +2193,8 @@ namespace eosiosystem {
           *
           * @param payer - the resource buyer
           * @param receiver - the resource receiver
-          * @param days - number of days of resource availability. Must match market configuration.
+          * @param days - number of days of resource availability. Must match market configuration. The resources
+          *    are returned at the end of the hour in which they elapse.
           * @param net_frac - fraction of net (100% = 10^15) managed by this market
           * @param cpu_frac - fraction of cpu (100% = 10^15) managed by this market
           * @param max_payment - the maximum amount `payer` is willing to pay. Tokens are withdrawn from
@@ -1914,6 +2203,17 @@ namespace eosiosystem {
          [[eosio::action]]
          void powerup( const name& payer, const name& receiver, uint32_t days, int64_t net_frac, int64_t cpu_frac, const asset& max_payment );
 
+         /**
+          * Returns the fee, resources and market utilization that `powerup` would result in if executed in the
+          * same block, including the expiry of the orders it would process. Fails as `powerup` does when the fee
+          * is below the minimum fee.
+          *
+          * @param net_frac - fraction of net (100% = 10^15) managed by this market
+          * @param cpu_frac - fraction of cpu (100% = 10^15) managed by this market
+          */
+         [[eosio::action, eosio::read_only]]
+         powerup_quote powerupquote( int64_t net_frac, int64_t cpu_frac );
+
          /**
           * limitauthchg opts into or out of restrictions on updateauth, deleteauth, linkauth, and unlinkauth.
           *
@@ -1957,6 +2257,7 @@ namespace eosiosystem {
          using defnetloan_action   = eosio::action_wrapper<"defnetloan"_n, &system_contract::defnetloan>;
          using updaterex_action    = eosio::action_wrapper<"updaterex"_n, &system_contract::updaterex>;
          using rexexec_action      = eosio::action_wrapper<"rexexec"_n, &system_contract::rexexec>;
+         using rexsettle_action    = eosio::action_wrapper<"rexsettle"_n, &system_contract::rexsettle>;
          using setrex_action       = eosio::action_wrapper<"setrex"_n, &system_contract::setrex>;
          using mvtosavings_action  = eosio::action_wrapper<"mvtosavings"_n, &system_contract::mvtosavings>;
          using mvfrsavings_action  = eosio::action_wrapper<"mvfrsavings"_n, &system_contract::mvfrsavings>;
@@ -1981,9 +2282,11 @@ namespace eosiosystem {
          using unregprod_action    = eosio::action_wrapper<"unregprod"_n, &system_contract::unregprod>;
          using setram_action       = eosio::action_wrapper<"setram"_n, &system_contract::setram>;
          using setramrate_action   = eosio::action_wrapper<"setramrate"_n, &system_contract::setramrate>;
+         using setblockinfo_action = eosio::action_wrapper<"setblockinfo"_n, &system_contract::setblockinfo>;
          using voteproducer_action = eosio::action_wrapper<"voteproducer"_n, &system_contract::voteproducer>;
          using voteupdate_action   = eosio::action_wrapper<"voteupdate"_n, &system_contract::voteupdate>;
          using regproxy_action     = eosio::action_wrapper<"regproxy"_n, &system_contract::regproxy>;
+         using proxyupdate_action  = eosio::action_wrapper<"proxyupdate"_n, &system_contract::proxyupdate>;
          using claimrewards_action = eosio::action_wrapper<"claimrewards"_n, &system_contract::claimrewards>;
          using rmvproducer_action  = eosio::action_wrapper<"rmvproducer"_n, &system_contract::rmvproducer>;
          using updtrevision_action = eosio::action_wrapper<"updtrevision"_n, &system_contract::updtrevision>;
@@ -2012,10 +2315,14 @@ namespace eosiosystem {
          bool execute_next_schedule();
 
          // defined in rex.cpp
-         void runrex( uint16_t max );
+         uint32_t runrex( uint16_t max );
+         void run_due_rex_maintenance();
+         void update_rex_maintenance_due();
          void update_rex_pool();
+         void migrate_rex_return_buckets();
          void update_resource_limits( const name& from, const name& receiver, int64_t delta_net, int64_t delta_cpu );
-         rex_order_outcome fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex );
+         rex_order_outcome fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex,
+                                           bool process_maturities = false );
          asset update_rex_account( const name& owner, const asset& proceeds, const asset& unstake_quant, bool force_vote_update = false );
          template <typename T>
          int64_t rent_rex( T& table, const name& from, const name& receiver, const asset& loan_payment, const asset& loan_fund );
@@ -2025,18 +2332,18 @@ namespace eosiosystem {
          void defund_rex_loan( T& table, const name& from, uint64_t loan_num, const asset& amount );
          void transfer_from_fund( const name& owner, const asset& amount );
          void transfer_to_fund( const name& owner, const asset& amount );
-         bool rex_loans_available()const;
+         bool rex_pool_initialized();
+         bool rex_pool_available();
+         bool rex_loans_available();
          static time_point_sec get_rex_maturity(const name& system_account_name = "eosio"_n );
          asset add_to_rex_balance( const name& owner, const asset& payment, const asset& rex_received );
+         void update_system_status();
          asset add_to_rex_pool( const asset& payment );
          void add_to_rex_return_pool( const asset& fee );
-         void process_rex_maturities( const rex_balance_table::const_iterator& bitr );
          void process_sell_matured_rex( const name owner );
          void process_buy_rex_to_savings( const name owner, const asset rex );
          void consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                        const asset& rex_in_sell_order );
-         int64_t read_rex_savings( const rex_balance_table::const_iterator& bitr );
-         void put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex );
          void update_rex_stake( const name& voter );
          void sell_rex( const name& from, const asset& rex );
 
@@ -2055,14 +2362,18 @@ namespace eosiosystem {
          void update_stake_delegated( const name from, const name receiver, const asset stake_net_delta, const asset stake_cpu_delta );
          void update_user_resources( const name from, const name receiver, const asset stake_net_delta, const asset stake_cpu_delta );
 
+         // defined in producer_pay.cpp
+         void flush_unpaid_blocks();
+
          // defined in voting.cpp
          void register_producer( const name& producer, const eosio::block_signing_authority& producer_authority, const std::string& url, uint16_t location );
          void update_elected_producers( const block_timestamp& timestamp );
+         void invalidate_producer_ranking();
+         void track_producer_votes( double old_votes, double new_votes );
          void update_votes( const name& voter, const name& proxy, const std::vector<name>& producers, bool voting );
-         void propagate_weight_change( const voter_info& voter );
-         double update_producer_votepay_share( const producers_table2::const_iterator& prod_itr,
-                                               const time_point& ct,
-                                               double shares_rate, bool reset_to_zero = false );
+         void propagate_weight_change( const voter_info& voter, bool flush = false );
+         void update_producer_votes( const producers_table::const_iterator& prod_itr, double votes_delta, const time_point& ct,
+                                     double& delta_change_rate, double& total_inactive_vpay_share );
          double update_total_votepay_share( const time_point& ct,
                                             double additional_shares_delta = 0.0, double shares_rate_delta = 0.0 );
 
@@ -2109,8 +2420,8 @@ namespace eosiosystem {
          void adjust_resources(name payer, name account, symbol core_symbol, int64_t net_delta, int64_t cpu_delta, bool must_not_be_managed = false);
          void process_powerup_queue(
             time_point_sec now, symbol core_symbol, powerup_state& state,
-            powerup_order_table& orders, uint32_t max_items, int64_t& net_delta_available,
-            int64_t& cpu_delta_available);
+            uint32_t max_items, int64_t& net_delta_available, int64_t& cpu_delta_available,
+            bool dry_run = false);
 
          // defined in block_info.cpp
          void add_to_blockinfo_table(const eosio::checksum256& previous_block_id, const eosio::block_timestamp timestamp) const;
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace eosiosystem::powerup_curve {
+
+   /**
+    * Fixed-point evaluation of the powerup price curve.
+    *
+    * Utilization fractions and fee amounts are represented in Q60 (`one` = 2^60) in unsigned 128-bit integers and every
+    * operation rounds down, so that a fee only depends on its integer inputs and can be reproduced bit-for-bit off chain.
+    * This header has no dependency on the contract library so that native tools and tests can include it.
+    */
+   using uint128 = unsigned __int128;
+
+   inline constexpr int     frac_bits = 60;
+   inline constexpr uint128 one       = uint128(1) << frac_bits;
+   inline constexpr uint128 ln2       = 799144290325165979ull; // ln(2) in Q60
+
+   // floor(a * b / one)
+   // @pre a < 2^126, b <= 2^61
+   inline uint128 mul(uint128 a, uint128 b) {
+      return (a >> frac_bits) * b + (((a & (one - 1)) * b) >> frac_bits);
+   }
+
+   // floor(a * one / b)
+   // @pre 0 < b < 2^113, a * one / b < 2^128
+   inline uint128 div(uint128 a, uint128 b) {
+      uint128 q = a / b;
+      uint128 r = a % b;
+      for (int i = 0; i < 4; ++i) {
+         r <<= 15;
+         q = (q << 15) + r / b;
+         r %= b;
+      }
+      return q;
+   }
+
+   // x^n
+   // @pre x <= one
+   inline uint128 pow_int(uint128 x, uint32_t n) {
+      uint128 result = one;
+      for (; n; n >>= 1) {
+         if (n & 1)
+            result = mul(result, x);
+         x = mul(x, x);
+      }
+      return result;
+   }
+
+   // -log2(x)
+   // @pre 0 < x <= one
+   inline uint128 neg_log2(uint128 x) {
+      uint128 result = 0;
+      for (; x < one; x <<= 1)
+         result += one;
+      // x is now in [1, 2); each squaring yields the next fractional bit of log2(x)
+      for (uint128 bit = one >> 1; bit; bit >>= 1) {
+         x = mul(x, x);
+         if (x >= 2 * one) {
+            x >>= 1;
+            result -= bit;
+         }
+      }
+      return result;
+   }
+
+   // 2^-y
+   inline uint128 exp2_neg(uint128 y) {
+      const uint128 n = y >> frac_bits;
+      const uint128 f = y & (one - 1);
+      if (n >= frac_bits)
+         return 0;
+      if (!f)
+         return one >> n;
+
+      // 2^(1 - f) = e^((1 - f) * ln(2)), whose Taylor series converges within 20 terms since (1 - f) * ln(2) < 0.7
+      const uint128 z   = mul(one - f, ln2);
+      uint128       sum = one;
+      for (uint128 term = one, k = 1; term; ++k) {
+         term = mul(term, z) / k;
+         sum += term;
+      }
+      return sum >> (n + 1);
+   }
+
+   // x^e, where e = exponent_integer + exponent_fraction / one
+   // @pre x <= one
+   inline uint128 pow(uint128 x, uint32_t exponent_integer, uint64_t exponent_fraction) {
+      if (!x)
+         return (exponent_integer || exponent_fraction) ? 0 : one;
+      uint128 result = pow_int(x, exponent_integer);
+      if (exponent_fraction)
+         result = mul(result, exp2_neg(mul(neg_log2(x), exponent_fraction)));
+      return result;
+   }
+
+   /**
+    * Fixed-point counterpart of the powerup fee: the price p(u) = min_price + (max_price - min_price) * u^(exponent - 1)
+    * is charged at the adjusted utilization for the part of the increase below it, and integrated over the
+    * utilization fraction u for the rest.
+    *
+    * @pre 1 <= exponent_integer + exponent_fraction / one
+    * @pre 0 <= min_price <= max_price
+    * @pre 0 <= utilization <= adjusted_utilization <= weight
+    * @pre 0 <= utilization_increase <= weight - utilization
+    */
+   inline int64_t fee(int64_t min_price, int64_t max_price, uint32_t exponent_integer, uint64_t exponent_fraction,
+                      int64_t weight, int64_t utilization, int64_t adjusted_utilization, int64_t utilization_increase) {
+      if (utilization_increase <= 0)
+         return 0;
+
+      auto fraction = [weight](int64_t utilization) { return div(uint128(utilization), uint128(weight)); };
+
+      uint128 result            = 0;
+      int64_t start_utilization = utilization;
+      int64_t end_utilization   = start_utilization + utilization_increase;
+
+      if (start_utilization < adjusted_utilization) {
+         uint128 price = uint128(max_price) << frac_bits;
+         if (exponent_integer > 1 || exponent_fraction)
+            price = (uint128(min_price) << frac_bits) +
+                    uint128(max_price - min_price) * pow(fraction(adjusted_utilization), exponent_integer - 1, exponent_fraction);
+         result += mul(price, fraction(std::min(utilization_increase, adjusted_utilization - start_utilization)));
+         start_utilization = adjusted_utilization;
+      }
+
+      if (start_utilization < end_utilization) {
+         const uint128 start_u = fraction(start_utilization);
+         const uint128 end_u   = fraction(end_utilization);
+         const uint128 start_p = pow(start_u, exponent_integer, exponent_fraction);
+         const uint128 end_p   = pow(end_u, exponent_integer, exponent_fraction);
+         result += uint128(min_price) * (end_u - start_u);
+         if (end_p > start_p)
+            result += div(uint128(max_price - min_price) * (end_p - start_p),
+                          (uint128(exponent_integer) << frac_bits) + exponent_fraction);
+      }
+
+      // A fee exceeding a token unit by less than the rounding error of the evaluation above, which is a few ulps of
+      // a fraction times max_price, is not rounded up to the next unit. This keeps exact fees exact.
+      const uint128 rounding_tolerance = uint128(max_price) << 8;
+      if (result <= rounding_tolerance)
+         return 0;
+      return int64_t((result - rounding_tolerance + one - 1) >> frac_bits);
+   }
+
+} // namespace eosiosystem::powerup_curve
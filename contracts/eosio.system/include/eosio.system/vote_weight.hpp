@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace eosiosystem::vote_weight {
+
+   /**
+    * Vote weight multiplier 2^(week/52), where week is the number of weeks since the block_timestamp epoch.
+    *
+    * The exponent is split into a power of two per 52 week period and a table of the 52 weekly fractions, so that the
+    * multiplier costs one multiply instead of a call to `std::pow`. It is within a few ulps of
+    * `std::pow(2, week / 52.0)`, whose rounded argument is itself off by up to a few ulps.
+    * This header has no dependency on the contract library so that native tools and tests can include it.
+    */
+
+   /// 2^(w/52) for w in [0, 52), i.e. the vote weight multiplier of each week within a 52 week period
+   inline constexpr double weekly_fractions[52] = {
+      1.0, 1.0134189906987003, 1.0270180507087725, 1.0407995963786307,
+      1.0547660764816467, 1.0689199726512586, 1.0832637998219208, 1.09780010667597,
+      1.1125314760964868, 1.127460525626237, 1.1425899079327673, 1.1579223112797459,
+      1.1734604600046263, 1.189207115002721, 1.2051650742177709, 1.2213371731390976,
+      1.237726285305428, 1.2543353228154785, 1.2711672368453906, 1.2882250181731114,
+      1.3055116977098096, 1.323030347038422, 1.3407840789594287, 1.3587760480439508,
+      1.3770094511942694, 1.3954875282118677, 1.4142135623730951, 1.4331908810125555,
+      1.452422856114325, 1.4719129049111028, 1.4916644904914018, 1.5116811224148876,
+      1.5319663573359739, 1.552523799635787, 1.5733571020626107, 1.594469966380923,
+      1.6158661440291455, 1.6375494367862173, 1.6595236974471135, 1.681792830507429,
+      1.7043607928571491, 1.7272315944837286, 1.7504092991846072, 1.773898025289284,
+      1.7977019463910837, 1.8218252920887412, 1.8462723487379369, 1.871047460212919,
+      1.896155028678343, 1.9215995153714713, 1.9473854413948684, 1.9735173885197304
+   };
+
+   /// std::pow remains the fallback outside of the 64 periods a power of two can be shifted over
+   inline double multiplier( int64_t week ) {
+      const int64_t periods = week / 52;
+      if( week < 0 || periods >= 64 ) {
+         return std::pow( 2, week / double( 52 ) );
+      }
+      return double( uint64_t(1) << periods ) * weekly_fractions[week % 52];
+   }
+
+} // namespace eosiosystem::vote_weight
@@ -10,6 +10,22 @@ inline uint32_t block_height_from_id(const eosio::checksum256& block_id)
    return ((arr[0] << 0x18) | (arr[1] << 0x10) | (arr[2] << 0x08) | arr[3]);
 }
 
+// Returns the state of the blockinfo table. When it does not exist yet, the table only holds version 0 records keyed by
+// block height, left over from before version 3.11.0, which are all erased.
+eosiosystem::block_info::block_info_state
+get_block_info_state(eosiosystem::block_info::block_info_state_singleton& state_table,
+                     eosiosystem::block_info::block_info_table&                 t)
+{
+   if (state_table.exists()) {
+      return state_table.get();
+   }
+
+   for (auto itr = t.begin(); itr != t.end();) {
+      itr = t.erase(itr);
+   }
+   return {};
+}
+
 } // namespace
 
 namespace eosiosystem {
@@ -20,28 +36,49 @@ void system_contract::add_to_blockinfo_table(const eosio::checksum256&    previo
    const uint32_t new_block_height    = block_height_from_id(previous_block_id) + 1;
    const auto     new_block_timestamp = static_cast<eosio::time_point>(timestamp);
 
-   block_info::block_info_table t(get_self(), 0);
+   block_info::block_info_state_singleton state_table(get_self(), 0);
+   block_info::block_info_table           t(get_self(), 0);
+   auto                                   state = get_block_info_state(state_table, t);
 
-   if (block_info::rolling_window_size > 0) {
-      // Add new entry to blockinfo table for the new block.
-      t.emplace(get_self(), [&](block_info::block_info_record& r) {
-         r.block_height    = new_block_height;
-         r.block_timestamp = new_block_timestamp;
-      });
-   }
+   const uint32_t window = state.rolling_window_size;
+   state.latest_block_height = new_block_height;
+   state_table.set(state, get_self());
 
-   // Erase up to two entries that have fallen out of the rolling window.
+   // Overwrite in place the slot of the block that fell out of the rolling window.
+   const uint32_t slot  = new_block_height % window;
+   auto           write = [&](block_info::block_info_record& r) {
+      r.version         = block_info::ring_buffer_record_version;
+      r.block_height    = new_block_height;
+      r.block_timestamp = new_block_timestamp;
+      r.slot.emplace(slot);
+   };
 
-   const uint32_t last_prunable_block_height =
-      std::max(new_block_height, block_info::rolling_window_size) - block_info::rolling_window_size;
+   if (auto itr = t.find(slot); itr != t.end()) {
+      t.modify(itr, eosio::same_payer, write);
+   } else {
+      t.emplace(get_self(), write);
+   }
+
+   // Erase up to two entries outside of the slots of the rolling window, which are left over from a larger window size.
 
    int count = 2;
-   for (auto itr = t.begin(), end = t.end();                                        //
-        itr != end && itr->block_height <= last_prunable_block_height && 0 < count; //
-        --count)                                                                    //
-   {
+   for (auto itr = t.lower_bound(window), end = t.end(); itr != end && 0 < count; --count) {
       itr = t.erase(itr);
    }
 }
 
+void system_contract::setblockinfo(uint32_t rolling_window_size)
+{
+   require_auth(get_self());
+
+   check(0 < rolling_window_size && rolling_window_size <= block_info::max_rolling_window_size,
+         "rolling_window_size must be between 1 and " + std::to_string(block_info::max_rolling_window_size));
+
+   block_info::block_info_state_singleton state_table(get_self(), 0);
+   block_info::block_info_table           t(get_self(), 0);
+   auto                                   state = get_block_info_state(state_table, t);
+   state.rolling_window_size = rolling_window_size;
+   state_table.set(state, get_self());
+}
+
 } // namespace eosiosystem
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <eosio/dispatcher.hpp>
 
 #include <cmath>
+#include <iterator>
 
 namespace eosiosystem {
 
@@ -16,33 +17,35 @@ namespace eosiosystem {
       return std::log1p(double(annual_rate)/double(100*inflation_precision));
    }
 
+   // Constructing the table handles below does not access the database: multi_index and singleton only record
+   // code and scope, and rows are read on first lookup. The global state rows are likewise read on first access
+   // (see cached_singleton), so an action only pays for the tables it actually uses.
    system_contract::system_contract( name s, name code, datastream<const char*> ds )
    :native(s,code,ds),
     _voters(get_self(), get_self().value),
     _producers(get_self(), get_self().value),
     _producers2(get_self(), get_self().value),
+    _unpaid_blocks(get_self(), get_self().value),
     _finalizer_keys(get_self(), get_self().value),
     _finalizers(get_self(), get_self().value),
     _last_prop_finalizers(get_self(), get_self().value),
     _fin_key_id_generator(get_self(), get_self().value),
-    _global(get_self(), get_self().value),
-    _global2(get_self(), get_self().value),
-    _global3(get_self(), get_self().value),
-    _global4(get_self(), get_self().value),
+    _gstate(get_self(), get_self().value, get_default_parameters),
+    _gstate2(get_self(), get_self().value),
+    _gstate3(get_self(), get_self().value),
+    _gstate4(get_self(), get_self().value, get_default_inflation_parameters),
     _schedules(get_self(), get_self().value),
     _rammarket(get_self(), get_self().value),
     _rexpool(get_self(), get_self().value),
     _rexretpool(get_self(), get_self().value),
     _rexretbuckets(get_self(), get_self().value),
+    _rexretring(get_self(), get_self().value),
     _rexfunds(get_self(), get_self().value),
     _rexbalance(get_self(), get_self().value),
     _rexorders(get_self(), get_self().value),
-    _rexmaturity(get_self(), get_self().value)
+    _rexmaturity(get_self(), get_self().value),
+    _rexmaint(get_self(), get_self().value)
    {
-      _gstate  = _global.exists() ? _global.get() : get_default_parameters();
-      _gstate2 = _global2.exists() ? _global2.get() : eosio_global_state2{};
-      _gstate3 = _global3.exists() ? _global3.get() : eosio_global_state3{};
-      _gstate4 = _global4.exists() ? _global4.get() : get_default_inflation_parameters();
    }
 
    eosio_global_state system_contract::get_default_parameters() {
@@ -65,20 +68,25 @@ namespace eosiosystem {
    }
 
    system_contract::~system_contract() {
-      _global.set( _gstate, get_self() );
-      _global2.set( _gstate2, get_self() );
-      _global3.set( _gstate3, get_self() );
-      _global4.set( _gstate4, get_self() );
+      // only the global state and REX pool rows that were read and modified by the action are written back
+      _gstate.save( get_self() );
+      _gstate2.save( get_self() );
+      _gstate3.save( get_self() );
+      _gstate4.save( get_self() );
+      _rexmaint.save( get_self() );
+      _rexpool.save();
+      _rexretpool.save();
+      _rexretring.save();
    }
 
    void system_contract::setram( uint64_t max_ram_size ) {
       require_auth( get_self() );
 
-      check( _gstate.max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
+      check( _gstate->max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
       check( max_ram_size < 1024ll*1024*1024*1024*1024, "ram size is unrealistic" );
-      check( max_ram_size > _gstate.total_ram_bytes_reserved, "attempt to set max below reserved" );
+      check( max_ram_size > _gstate->total_ram_bytes_reserved, "attempt to set max below reserved" );
 
-      auto delta = int64_t(max_ram_size) - int64_t(_gstate.max_ram_size);
+      auto delta = int64_t(max_ram_size) - int64_t(_gstate->max_ram_size);
       auto itr = _rammarket.find(ramcore_symbol.raw());
 
       /**
@@ -88,18 +96,18 @@ namespace eosiosystem {
          m.base.balance.amount += delta;
       });
 
-      _gstate.max_ram_size = max_ram_size;
+      _gstate->max_ram_size = max_ram_size;
    }
 
    void system_contract::update_ram_supply() {
       auto cbt = eosio::current_block_time();
 
-      if( cbt <= _gstate2.last_ram_increase ) return;
+      if( cbt <= _gstate2->last_ram_increase ) return;
 
-      if (_gstate2.new_ram_per_block != 0) {
+      if (_gstate2->new_ram_per_block != 0) {
          auto itr     = _rammarket.find(ramcore_symbol.raw());
-         auto new_ram = (cbt.slot - _gstate2.last_ram_increase.slot) * _gstate2.new_ram_per_block;
-         _gstate.max_ram_size += new_ram;
+         auto new_ram = (cbt.slot - _gstate2->last_ram_increase.slot) * _gstate2->new_ram_per_block;
+         _gstate->max_ram_size += new_ram;
 
          /**
           *  Increase the amount of ram for sale based upon the change in max ram size.
@@ -107,14 +115,14 @@ namespace eosiosystem {
          _rammarket.modify(itr, same_payer, [&](auto& m) { m.base.balance.amount += new_ram; });
       }
 
-      _gstate2.last_ram_increase = cbt;
+      _gstate2->last_ram_increase = cbt;
    }
 
    void system_contract::setramrate( uint16_t bytes_per_block ) {
       require_auth( get_self() );
 
       update_ram_supply(); // make sure all previous blocks are accounted at the old rate before updating the rate
-      _gstate2.new_ram_per_block = bytes_per_block;
+      _gstate2->new_ram_per_block = bytes_per_block;
    }
 
    void system_contract::channel_to_system_fees( const name& from, const asset& amount ) {
@@ -128,8 +136,8 @@ namespace eosiosystem {
 
    void system_contract::setparams( const blockchain_parameters_t& params ) {
       require_auth( get_self() );
-      (eosio::blockchain_parameters&)(_gstate) = params;
-      check( 3 <= _gstate.max_authority_depth, "max_authority_depth should be at least 3" );
+      (eosio::blockchain_parameters&)(*_gstate) = params;
+      check( 3 <= _gstate->max_authority_depth, "max_authority_depth should be at least 3" );
 #ifndef SYSTEM_BLOCKCHAIN_PARAMETERS
       set_blockchain_parameters( params );
 #else
@@ -427,6 +435,65 @@ namespace eosiosystem {
       idx.erase(itr);
    }
 
+   // adds the valid patterns to the `denylist_shard_table` (or removes them from it), rewriting only the shards
+   // of the pattern sizes present in `patterns`
+   static void update_denylist_shards( name self, const std::vector<name>& patterns, bool add ) {
+      std::vector<denylist_pattern_group> changes; // sorted by increasing size
+      for (auto n : patterns) {
+         canon_name_t pattern(n.value);
+         if (!pattern.valid())
+            continue;
+         auto change = std::lower_bound(changes.begin(), changes.end(), pattern.size(),
+                                        [](const auto& g, uint64_t size) { return g.size < size; });
+         if (change == changes.end() || change->size != pattern.size())
+            change = changes.insert(change, denylist_pattern_group{ static_cast<uint8_t>(pattern.size()), {} });
+         change->values.push_back(pattern._value);
+      }
+
+      denylist_shard_table shards(self, self.value);
+      for (auto& change : changes) {
+         std::sort(change.values.begin(), change.values.end());
+         change.values.erase(std::unique(change.values.begin(), change.values.end()), change.values.end());
+
+         auto shard = shards.find(change.size);
+         if (shard == shards.end()) {
+            if (add) {
+               shards.emplace(self, [&](auto& s) {
+                  s.size   = change.size;
+                  s.values = std::move(change.values);
+               });
+            }
+            continue;
+         }
+
+         std::vector<uint64_t> values;
+         values.reserve(shard->values.size() + (add ? change.values.size() : 0));
+         if (add)
+            std::set_union(shard->values.cbegin(), shard->values.cend(), change.values.cbegin(), change.values.cend(),
+                           std::back_inserter(values));
+         else
+            std::set_difference(shard->values.cbegin(), shard->values.cend(), change.values.cbegin(), change.values.cend(),
+                                std::back_inserter(values));
+
+         if (values.empty()) {
+            shards.erase(shard);
+         } else if (values.size() != shard->values.size()) {
+            shards.modify(shard, same_payer, [&](auto& s) {
+               s.values = std::move(values);
+            });
+         }
+      }
+   }
+
+   // moves the patterns still stored in the legacy `account_name_blacklist` to the `denylist_shard_table`
+   static void migrate_denylist( name self ) {
+      account_name_blacklist_table bl_table(self, self.value);
+      if (auto itr = bl_table.begin(); itr != bl_table.end()) {
+         update_denylist_shards(self, itr->disallowed, true);
+         bl_table.erase(itr);
+      }
+   }
+
    void system_contract::denynames( const std::vector<name>& patterns ) {
       // no auth necessary since the hash verification is enough
       
@@ -443,32 +510,13 @@ namespace eosiosystem {
       if (present)
          dh_idx.erase(dh_itr); // names patterns have been added - remove hash
 
-      auto add_patterns_to = [&patterns](auto& current) {
-         // number of blackcklist name patterns expected to be small, so quadratic check OK
-         for (auto n : patterns) {
-            // check that pattern is valid (pattern should not be empty or more than 12 character long)
-            // but silently ignore invalid patterns.
-            // This allows to have a 13 character name in the vector, serving as a salt for the hash to
-            // make the pattern harder to guess, while not unnecessarily preventing another name registration,
-            // because this 13 char pattern will be skipped over and not added to the blacklist.
-            // -----------------------------------------------------------------------------------------------
-            canon_name_t pattern(n);
-            if (pattern.valid() && std::find(std::cbegin(current), std::cend(current), n) == std::cend(current))
-               current.push_back(n);
-         }
-      };
-
-      account_name_blacklist_table bl_table(get_self(), get_self().value);
-      
-      if (auto bl_itr = bl_table.begin(); bl_itr != bl_table.end()) {
-         bl_table.modify(bl_itr, same_payer, [&](auto& blacklist) {
-            add_patterns_to(blacklist.disallowed);
-         });
-      } else {
-         bl_table.emplace(get_self(), [&](auto& blacklist) {
-            add_patterns_to(blacklist.disallowed);
-         });
-      }
+      // invalid patterns (empty or more than 12 character long) are silently ignored.
+      // This allows to have a 13 character name in the vector, serving as a salt for the hash to
+      // make the pattern harder to guess, while not unnecessarily preventing another name registration,
+      // because this 13 char pattern will be skipped over and not added to the blacklist.
+      // -----------------------------------------------------------------------------------------------
+      migrate_denylist(get_self());
+      update_denylist_shards(get_self(), patterns, true);
    }
 
    void system_contract::undenynames( const std::vector<name>& patterns ) {
@@ -479,20 +527,9 @@ namespace eosiosystem {
       
       check(patterns.size() <= 512, "Cannot provide more than 512 patterns in one action call");
 
-      account_name_blacklist_table bl_table(get_self(), get_self().value);
-
-      if (auto itr = bl_table.begin(); itr != bl_table.end()) {
-         bl_table.modify(itr, same_payer, [&](auto& blacklist) {
-            auto& current = blacklist.disallowed;
-
-            // number of blackcklist name patterns expected to be small, so quadratic check OK
-            for (auto n : patterns) {
-               if (auto itr = std::find(std::begin(current), std::end(current), n); itr != std::end(current))
-                  current.erase(itr);
-            }
-         });
-      }
-      // no-op for empty blacklist table, consistent with ignoring names not in the list
+      // names not in the blacklist are ignored
+      migrate_denylist(get_self());
+      update_denylist_shards(get_self(), patterns, false);
    }
 
    void system_contract::activate( const eosio::checksum256& feature_digest ) {
@@ -511,15 +548,16 @@ namespace eosiosystem {
       _producers.modify( prod, same_payer, [&](auto& p) {
             p.deactivate();
          });
+      invalidate_producer_ranking();
    }
 
    void system_contract::updtrevision( uint8_t revision ) {
       require_auth( get_self() );
-      check( _gstate2.revision < 255, "can not increment revision" ); // prevent wrap around
-      check( revision == _gstate2.revision + 1, "can only increment revision by one" );
+      check( _gstate2->revision < 255, "can not increment revision" ); // prevent wrap around
+      check( revision == _gstate2->revision + 1, "can only increment revision by one" );
       check( revision <= 1, // set upper bound to greatest revision supported in the code
              "specified revision is not yet supported by the code" );
-      _gstate2.revision = revision;
+      _gstate2->revision = revision;
    }
 
    void system_contract::setinflation( int64_t annual_rate, int64_t inflation_pay_factor, int64_t votepay_factor ) {
@@ -531,10 +569,9 @@ namespace eosiosystem {
       if ( votepay_factor < pay_factor_precision ) {
          check( false, "votepay_factor must not be less than " + std::to_string(pay_factor_precision) );
       }
-      _gstate4.continuous_rate      = get_continuous_rate(annual_rate);
-      _gstate4.inflation_pay_factor = inflation_pay_factor;
-      _gstate4.votepay_factor       = votepay_factor;
-      _global4.set( _gstate4, get_self() );
+      _gstate4->continuous_rate      = get_continuous_rate(annual_rate);
+      _gstate4->inflation_pay_factor = inflation_pay_factor;
+      _gstate4->votepay_factor       = votepay_factor;
    }
 
    void system_contract::setpayfactor( int64_t inflation_pay_factor, int64_t votepay_factor ) {
@@ -545,9 +582,8 @@ namespace eosiosystem {
       if ( votepay_factor < pay_factor_precision ) {
          check( false, "votepay_factor must not be less than " + std::to_string(pay_factor_precision) );
       }
-      _gstate4.inflation_pay_factor = inflation_pay_factor;
-      _gstate4.votepay_factor       = votepay_factor;
-      _global4.set( _gstate4, get_self() );
+      _gstate4->inflation_pay_factor = inflation_pay_factor;
+      _gstate4->votepay_factor       = votepay_factor;
    }
 
    void system_contract::setschedule( const time_point_sec start_time, double continuous_rate )
@@ -590,8 +626,7 @@ namespace eosiosystem {
       if (itr == _schedules.end()) return false; // no schedules to execute
 
       if ( current_time_point().sec_since_epoch() >= itr->start_time.sec_since_epoch() ) {
-         _gstate4.continuous_rate = itr->continuous_rate;
-         _global4.set( _gstate4, get_self() );
+         _gstate4->continuous_rate = itr->continuous_rate;
          _schedules.erase( itr );
          return true;
       }
@@ -634,27 +669,38 @@ namespace eosiosystem {
             }
          }
     
-         // check that the account does not match a blacklist pattern stored in `account_name_blacklist_table`
+         // check that the account does not match a blacklist pattern. Only the shards of patterns not longer than
+         // the account name are read. No shard is written before the legacy `account_name_blacklist_table` is
+         // migrated, so the legacy table is only read while there is no shard.
          // -------------------------------------------------------------------------------------------------------
-         account_name_blacklist_table bl_table(get_self(), get_self().value);
-         auto itr = bl_table.begin();
-         bool present = (itr != bl_table.end());
-
-         if (present) {
-            const std::vector<name>& blacklist{itr->disallowed};
-            for (auto pattern : blacklist) {
-               check(name_allowed(new_account_name, pattern),
-                     "Account name " + new_account_name.to_string() + " creation disallowed by rule: " + pattern.to_string());
+         const auto account_size = canon_name_t(new_account_name.value).size();
+         denylist_shard_table shards(get_self(), get_self().value);
+         auto shard = shards.begin();
+         if (shard == shards.end()) {
+            account_name_blacklist_table bl_table(get_self(), get_self().value);
+            if (auto itr = bl_table.begin(); itr != bl_table.end()) {
+               const std::vector<name>& blacklist{itr->disallowed};
+               const canon_name_positions account_positions(canon_name_t(new_account_name.value));
+               for (auto pattern : blacklist) {
+                  check(name_allowed(account_positions, pattern),
+                        "Account name " + new_account_name.to_string() + " creation disallowed by rule: " + pattern.to_string());
+               }
+            }
+         }
+         for (; shard != shards.end() && shard->size <= account_size; ++shard) {
+            if (auto pattern = find_disallowing_pattern(new_account_name, *shard)) {
+               check(false, "Account name " + new_account_name.to_string() + " creation disallowed by rule: " + pattern->to_string());
             }
          }
       }
 
       user_resources_table  userres( get_self(), new_account_name.value );
+      const auto core = system_contract::get_core_symbol();
 
       userres.emplace( new_account_name, [&]( auto& res ) {
         res.owner = new_account_name;
-        res.net_weight = asset( 0, system_contract::get_core_symbol() );
-        res.cpu_weight = asset( 0, system_contract::get_core_symbol() );
+        res.net_weight = asset( 0, core );
+        res.cpu_weight = asset( 0, core );
       });
 
       set_resource_limits( new_account_name, 0, 0, 0 );
@@ -690,11 +736,17 @@ namespace eosiosystem {
       _rammarket.emplace( get_self(), [&]( auto& m ) {
          m.supply.amount = 100000000000000ll;
          m.supply.symbol = ramcore_symbol;
-         m.base.balance.amount = int64_t(_gstate.free_ram());
+         m.base.balance.amount = int64_t(_gstate->free_ram());
          m.base.balance.symbol = ram_symbol;
          m.quote.balance.amount = system_token_supply.amount / 1000;
          m.quote.balance.symbol = core;
       });
+      update_system_status();
+
+      // global state rows are only written when modified, make sure they all exist once the system is initialized
+      _gstate2.get();
+      _gstate3.get();
+      _gstate4.get();
 
       token::open_action open_act{ token_account, { {get_self(), active_permission} } };
       open_act.send( rex_account, core, get_self() );
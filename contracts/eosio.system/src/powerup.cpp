@@ -1,6 +1,7 @@
 #include <eosio.system/eosio.system.hpp>
 #include <eosio/action.hpp>
 #include <eosio.system/powerup.results.hpp>
+#include <eosio.system/powerup_curve.hpp>
 #include <algorithm>
 #include <cmath>
 
@@ -67,20 +68,66 @@ void system_contract::adjust_resources(name payer, name account, symbol core_sym
    }
 } // system_contract::adjust_resources
 
+// If `dry_run` is set, only `state` and the deltas are updated: the expired orders are left in their tables and the
+// resources of their owners are not adjusted.
 void system_contract::process_powerup_queue(time_point_sec now, symbol core_symbol, powerup_state& state,
-                                           powerup_order_table& orders, uint32_t max_items, int64_t& net_delta_available,
-                                           int64_t& cpu_delta_available) {
+                                           uint32_t max_items, int64_t& net_delta_available,
+                                           int64_t& cpu_delta_available, bool dry_run) {
    update_utilization(now, state.net);
    update_utilization(now, state.cpu);
+   // Resources of expired orders are returned once per owner, after all of them are erased
+   struct owner_delta {
+      name    owner;
+      int64_t net_weight = 0;
+      int64_t cpu_weight = 0;
+   };
+   std::vector<owner_delta> owner_deltas;
+   auto retire = [&](const name& owner, int64_t net_weight, int64_t cpu_weight) {
+      net_delta_available += net_weight;
+      cpu_delta_available += cpu_weight;
+      if (!dry_run)
+         owner_deltas.push_back({ owner, net_weight, cpu_weight });
+   };
+
+   // orders placed before version 3.11.0
+   powerup_order_table orders{ get_self(), 0 };
    auto idx = orders.get_index<"byexpires"_n>();
-   while (max_items--) {
-      auto it = idx.begin();
-      if (it == idx.end() || it->expires > now)
+   for (auto it = idx.begin(); max_items > 0 && it != idx.end() && it->expires <= now; --max_items) {
+      retire(it->owner, it->net_weight, it->cpu_weight);
+      if (dry_run)
+         ++it;
+      else
+         it = idx.erase(it);
+   }
+
+   // A bucket is erased once all of its entries are; `max_items` may stop in the middle of one
+   powerup_bucket_table buckets{ get_self(), 0 };
+   for (auto bucket = buckets.begin(); max_items > 0 && bucket != buckets.end() && bucket->expires <= now;) {
+      powerup_entry_table entries{ get_self(), bucket->expires.utc_seconds };
+      auto                it = entries.begin();
+      for (; max_items > 0 && it != entries.end(); --max_items) {
+         retire(it->owner, it->net_weight, it->cpu_weight);
+         if (dry_run)
+            ++it;
+         else
+            it = entries.erase(it);
+      }
+      if (it != entries.end())
          break;
-      net_delta_available += it->net_weight;
-      cpu_delta_available += it->cpu_weight;
-      adjust_resources(get_self(), it->owner, core_symbol, -it->net_weight, -it->cpu_weight);
-      idx.erase(it);
+      if (dry_run)
+         ++bucket;
+      else
+         bucket = buckets.erase(bucket);
+   }
+   std::stable_sort(owner_deltas.begin(), owner_deltas.end(),
+                    [](const owner_delta& a, const owner_delta& b) { return a.owner < b.owner; });
+   for (auto it = owner_deltas.begin(); it != owner_deltas.end();) {
+      owner_delta total = *it;
+      for (++it; it != owner_deltas.end() && it->owner == total.owner; ++it) {
+         total.net_weight += it->net_weight;
+         total.cpu_weight += it->cpu_weight;
+      }
+      adjust_resources(get_self(), total.owner, core_symbol, -total.net_weight, -total.cpu_weight);
    }
    state.net.utilization -= net_delta_available;
    state.cpu.utilization -= cpu_delta_available;
@@ -201,6 +248,7 @@ void system_contract::cfgpowerup(powerup_config& args) {
                          std::numeric_limits<int64_t>::max(),
                    "assumed_stake_weight/target_weight_ratio is too large");
       eosio::check(*args.exponent >= 1.0, "exponent must be >= 1");
+      eosio::check(*args.exponent < std::numeric_limits<uint32_t>::max(), "exponent is too large");
       eosio::check(*args.decay_secs >= 1, "decay_secs must be >= 1");
       eosio::check(args.max_price->symbol == core_symbol, "max_price doesn't match core symbol");
       eosio::check(args.max_price->amount > 0, "max_price must be positive");
@@ -240,6 +288,8 @@ void system_contract::cfgpowerup(powerup_config& args) {
 
    update(state.net, args.net);
    update(state.cpu, args.cpu);
+   state.net_curve.emplace(powerup_price_curve::from_exponent(state.net.exponent));
+   state.cpu_curve.emplace(powerup_price_curve::from_exponent(state.cpu.exponent));
 
    update_weight(now, state.net, net_delta_available);
    update_weight(now, state.cpu, cpu_delta_available);
@@ -259,65 +309,45 @@ void system_contract::cfgpowerup(powerup_config& args) {
  *  @pre 0 <= state.utilization <= state.adjusted_utilization <= state.weight
  *  @pre 0 <= utilization_increase <= (state.weight - state.utilization)
  */
-int64_t calc_powerup_fee(const powerup_state_resource& state, int64_t utilization_increase) {
-   if( utilization_increase <= 0 ) return 0;
-
+int64_t calc_powerup_fee(const powerup_state_resource& state, const powerup_price_curve& curve,
+                         int64_t utilization_increase) {
    // Let p(u) = price as a function of the utilization fraction u which is defined for u in [0.0, 1.0].
    // Let f(u) = integral of the price function p(x) from x = 0.0 to x = u, again defined for u in [0.0, 1.0].
 
    // In particular we choose f(u) = min_price * u + ((max_price - min_price) / exponent) * (u ^ exponent).
    // And so p(u) = min_price + (max_price - min_price) * (u ^ (exponent - 1.0)).
 
-   // Returns f(double(end_utilization)/state.weight) - f(double(start_utilization)/state.weight) which is equivalent to
-   // the integral of p(x) from x = double(start_utilization)/state.weight to x = double(end_utilization)/state.weight.
-   // @pre 0 <= start_utilization <= end_utilization <= state.weight
-   auto price_integral_delta = [&state](int64_t start_utilization, int64_t end_utilization) -> double {
-      double coefficient = (state.max_price.amount - state.min_price.amount) / state.exponent;
-      double start_u     = double(start_utilization) / state.weight;
-      double end_u       = double(end_utilization) / state.weight;
-      return state.min_price.amount * end_u - state.min_price.amount * start_u +
-               coefficient * std::pow(end_u, state.exponent) - coefficient * std::pow(start_u, state.exponent);
-   };
-
-   // Returns p(double(utilization)/state.weight).
-   // @pre 0 <= utilization <= state.weight
-   auto price_function = [&state](int64_t utilization) -> double {
-      double price = state.min_price.amount;
-      // state.exponent >= 1.0, therefore the exponent passed into std::pow is >= 0.0.
-      // Since the exponent passed into std::pow could be 0.0 and simultaneously so could double(utilization)/state.weight,
-      // the safest thing to do is handle that as a special case explicitly rather than relying on std::pow to return 1.0
-      // instead of triggering a domain error.
-      double new_exponent = state.exponent - 1.0;
-      if (new_exponent <= 0.0) {
-         return state.max_price.amount;
-      } else {
-         price += (state.max_price.amount - state.min_price.amount) * std::pow(double(utilization) / state.weight, new_exponent);
-      }
-
-      return price;
-   };
-
-   double  fee = 0.0;
-   int64_t start_utilization = state.utilization;
-   int64_t end_utilization   = start_utilization + utilization_increase;
-
-   if (start_utilization < state.adjusted_utilization) {
-      fee += price_function(state.adjusted_utilization) *
-               std::min(utilization_increase, state.adjusted_utilization - start_utilization) / state.weight;
-      start_utilization = state.adjusted_utilization;
-   }
+   // The part of the increase below the adjusted utilization is charged at p(adjusted_utilization / weight), and the
+   // rest at f(end_utilization / weight) - f(start_utilization / weight). Both are evaluated in fixed point.
+   return powerup_curve::fee(state.min_price.amount, state.max_price.amount, curve.exponent_integer,
+                             curve.exponent_fraction, state.weight, state.utilization, state.adjusted_utilization,
+                             utilization_increase);
+}
 
-   if (start_utilization < end_utilization) {
-      fee += price_integral_delta(start_utilization, end_utilization);
-   }
+// Reserves `frac` of the resource market into `amount`, and returns the fee
+int64_t reserve_powerup_resource(int64_t frac, int64_t& amount, powerup_state_resource& state,
+                                 const powerup_price_curve& curve) {
+   if (!frac)
+      return 0;
+   amount = int128_t(frac) * state.weight / powerup_frac;
+   eosio::check(state.weight, "market doesn't have resources available");
+   eosio::check(state.utilization + amount <= state.weight, "market doesn't have enough resources available");
+   int64_t fee = calc_powerup_fee(state, curve, amount);
+   eosio::check(fee > 0, "calculated fee is below minimum; try powering up with more resources");
+   state.utilization += amount;
+   return fee;
+}
 
-   return std::ceil(fee);
+void check_powerup_fracs(int64_t net_frac, int64_t cpu_frac) {
+   eosio::check(net_frac >= 0, "net_frac can't be negative");
+   eosio::check(cpu_frac >= 0, "cpu_frac can't be negative");
+   eosio::check(net_frac <= powerup_frac, "net can't be more than 100%");
+   eosio::check(cpu_frac <= powerup_frac, "cpu can't be more than 100%");
 }
 
 void system_contract::powerupexec(const name& user, uint16_t max) {
    require_auth(user);
    powerup_state_singleton state_sing{ get_self(), 0 };
-   powerup_order_table     orders{ get_self(), 0 };
    eosio::check(state_sing.exists(), "powerup hasn't been initialized");
    auto           state       = state_sing.get();
    time_point_sec now         = eosio::current_time_point();
@@ -325,7 +355,7 @@ void system_contract::powerupexec(const name& user, uint16_t max) {
 
    int64_t net_delta_available = 0;
    int64_t cpu_delta_available = 0;
-   process_powerup_queue(now, core_symbol, state, orders, max, net_delta_available, cpu_delta_available);
+   process_powerup_queue(now, core_symbol, state, max, net_delta_available, cpu_delta_available);
 
    adjust_resources(get_self(), reserve_account, core_symbol, net_delta_available, cpu_delta_available, true);
    state_sing.set(state, get_self());
@@ -335,39 +365,23 @@ void system_contract::powerup(const name& payer, const name& receiver, uint32_t
                              const asset& max_payment) {
    require_auth(payer);
    powerup_state_singleton state_sing{ get_self(), 0 };
-   powerup_order_table     orders{ get_self(), 0 };
    eosio::check(state_sing.exists(), "powerup hasn't been initialized");
    auto           state       = state_sing.get();
    time_point_sec now         = eosio::current_time_point();
    auto           core_symbol = get_core_symbol();
    eosio::check(max_payment.symbol == core_symbol, "max_payment doesn't match core symbol");
    eosio::check(days == state.powerup_days, "days doesn't match configuration");
-   eosio::check(net_frac >= 0, "net_frac can't be negative");
-   eosio::check(cpu_frac >= 0, "cpu_frac can't be negative");
-   eosio::check(net_frac <= powerup_frac, "net can't be more than 100%");
-   eosio::check(cpu_frac <= powerup_frac, "cpu can't be more than 100%");
+   check_powerup_fracs(net_frac, cpu_frac);
 
    int64_t net_delta_available = 0;
    int64_t cpu_delta_available = 0;
-   process_powerup_queue(now, core_symbol, state, orders, 2, net_delta_available, cpu_delta_available);
+   process_powerup_queue(now, core_symbol, state, 2, net_delta_available, cpu_delta_available);
 
    eosio::asset fee{ 0, core_symbol };
-   auto         process = [&](int64_t frac, int64_t& amount, powerup_state_resource& state) {
-      if (!frac)
-         return;
-      amount = int128_t(frac) * state.weight / powerup_frac;
-      eosio::check(state.weight, "market doesn't have resources available");
-      eosio::check(state.utilization + amount <= state.weight, "market doesn't have enough resources available");
-      int64_t f = calc_powerup_fee(state, amount);
-      eosio::check(f > 0, "calculated fee is below minimum; try powering up with more resources");
-      fee.amount += f;
-      state.utilization += amount;
-   };
-
-   int64_t net_amount = 0;
-   int64_t cpu_amount = 0;
-   process(net_frac, net_amount, state.net);
-   process(cpu_frac, cpu_amount, state.cpu);
+   int64_t      net_amount = 0;
+   int64_t      cpu_amount = 0;
+   fee.amount += reserve_powerup_resource(net_frac, net_amount, state.net, state.get_net_curve());
+   fee.amount += reserve_powerup_resource(cpu_frac, cpu_amount, state.cpu, state.get_cpu_curve());
    if (fee > max_payment) {
       std::string error_msg = "max_payment is less than calculated fee: ";
       error_msg += fee.to_string();
@@ -375,13 +389,27 @@ void system_contract::powerup(const name& payer, const name& receiver, uint32_t
    }
    eosio::check(fee >= state.min_powerup_fee, "calculated fee is below minimum; try powering up with more resources");
 
-   orders.emplace(payer, [&](auto& order) {
-      order.id         = orders.available_primary_key();
-      order.owner      = receiver;
-      order.net_weight = net_amount;
-      order.cpu_weight = cpu_amount;
-      order.expires    = now + eosio::days(days);
-   });
+   // All orders placed within the same hour expire together, at the end of the hour. The orders of a receiver are
+   // summed into a single entry of the bucket. Both rows have a fixed size and are billed to the payer who creates them.
+   const uint32_t interval = powerup_expiry_bucket::bucket_interval;
+   const time_point_sec expires{ ((now + eosio::days(days)).utc_seconds + interval - 1) / interval * interval };
+   powerup_bucket_table buckets{ get_self(), 0 };
+   if (buckets.find(expires.utc_seconds) == buckets.end()) {
+      buckets.emplace(payer, [&](auto& bucket) { bucket.expires = expires; });
+   }
+   powerup_entry_table entries{ get_self(), expires.utc_seconds };
+   if (auto it = entries.find(receiver.value); it != entries.end()) {
+      entries.modify(it, same_payer, [&](auto& entry) {
+         entry.net_weight += net_amount;
+         entry.cpu_weight += cpu_amount;
+      });
+   } else {
+      entries.emplace(payer, [&](auto& entry) {
+         entry.owner      = receiver;
+         entry.net_weight = net_amount;
+         entry.cpu_weight = cpu_amount;
+      });
+   }
    net_delta_available -= net_amount;
    cpu_delta_available -= cpu_amount;
 
@@ -399,4 +427,27 @@ void system_contract::powerup(const name& payer, const name& receiver, uint32_t
    logsystemfee_act.send( powerup_account, fee, "buy powerup" );
 }
 
-} // namespace eosiosystem
\ No newline at end of file
+powerup_quote system_contract::powerupquote(int64_t net_frac, int64_t cpu_frac) {
+   powerup_state_singleton state_sing{ get_self(), 0 };
+   eosio::check(state_sing.exists(), "powerup hasn't been initialized");
+   auto           state       = state_sing.get();
+   time_point_sec now         = eosio::current_time_point();
+   auto           core_symbol = get_core_symbol();
+   check_powerup_fracs(net_frac, cpu_frac);
+
+   // same steps as `powerup`, applied to a copy of the state
+   int64_t net_delta_available = 0;
+   int64_t cpu_delta_available = 0;
+   process_powerup_queue(now, core_symbol, state, 2, net_delta_available, cpu_delta_available, true);
+
+   powerup_quote quote;
+   quote.fee = { 0, core_symbol };
+   quote.fee.amount += reserve_powerup_resource(net_frac, quote.net_amount, state.net, state.get_net_curve());
+   quote.fee.amount += reserve_powerup_resource(cpu_frac, quote.cpu_amount, state.cpu, state.get_cpu_curve());
+   eosio::check(quote.fee >= state.min_powerup_fee, "calculated fee is below minimum; try powering up with more resources");
+   quote.net_utilization = state.net.utilization;
+   quote.cpu_utilization = state.cpu.utilization;
+   return quote;
+}
+
+} // namespace eosiosystem
@@ -4,6 +4,7 @@
 
 namespace eosiosystem {
 
+   using eosio::current_block_time;
    using eosio::current_time_point;
    using eosio::token;
    using eosio::seconds;
@@ -71,7 +72,7 @@ namespace eosiosystem {
       transfer_from_fund( from, amount );
       const asset rex_received    = add_to_rex_pool( amount );
       const asset delta_rex_stake = add_to_rex_balance( from, amount, rex_received );
-      runrex(2);
+      run_due_rex_maintenance();
       update_rex_account( from, asset( 0, core_symbol() ), delta_rex_stake );
 
       process_buy_rex_to_savings( from, rex_received );
@@ -119,7 +120,7 @@ namespace eosiosystem {
       }
       const asset rex_received = add_to_rex_pool( payment );
       auto rex_stake_delta = add_to_rex_balance( owner, payment, rex_received );
-      runrex(2);
+      run_due_rex_maintenance();
       update_rex_account( owner, asset( 0, core_symbol() ), rex_stake_delta - payment, true );
 
       process_buy_rex_to_savings( owner, rex_received );
@@ -139,20 +140,28 @@ namespace eosiosystem {
 
    void system_contract::sell_rex( const name& from, const asset& rex )
    {
-      runrex(2);
+      run_due_rex_maintenance();
 
       auto bitr = _rexbalance.require_find( from.value, "user must first buyrex" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol,
              "asset must be a positive amount of (REX, 4)" );
-      process_rex_maturities( bitr );
-      check( rex.amount <= bitr->matured_rex, "insufficient available rex" );
+      const uint32_t today = rex_maturity_days::day_of( current_time_point() );
+      {
+         auto balance = *bitr;
+         balance.process_maturities( today );
+         check( rex.amount <= balance.matured_rex, "insufficient available rex" );
+      }
 
-      const auto current_order = fill_rex_order( bitr, rex );
+      const auto current_order = fill_rex_order( bitr, rex, true );
       if ( current_order.success && current_order.proceeds.amount == 0 ) {
          check( false, "proceeds are negligible" );
       }
       asset pending_sell_order = update_rex_account( from, current_order.proceeds, current_order.stake_change );
       if ( !current_order.success ) {
+         /// maturities are processed by fill_rex_order only if the order is filled
+         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+            rb.process_maturities( today );
+         });
          if ( from == "b1"_n ) {
             check( false, "b1 sellrex orders should not be queued" );
          }
@@ -170,6 +179,7 @@ namespace eosiosystem {
                order.stake_change  = asset( 0, core_symbol() );
                order.order_time    = current_time_point();
             });
+            _rexmaint->next_due = time_point_sec::min(); /// queued order is retried by the next REX action
          } else {
             _rexorders.modify( oitr, same_payer, [&]( auto& order ) {
                order.rex_requested.amount += rex.amount;
@@ -248,14 +258,13 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      runrex(2);
+      run_due_rex_maintenance();
 
       auto itr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       const asset init_stake = itr->vote_stake;
 
-      auto rexpool_itr = _rexpool.begin();
-      const int64_t total_rex      = rexpool_itr->total_rex.amount;
-      const int64_t total_lendable = rexpool_itr->total_lendable.amount;
+      const int64_t total_rex      = _rexpool->total_rex.amount;
+      const int64_t total_lendable = _rexpool->total_lendable.amount;
       const int64_t rex_balance    = itr->rex_balance.amount;
 
       asset current_stake( 0, core_symbol() );
@@ -264,10 +273,10 @@ namespace eosiosystem {
       }
       _rexbalance.modify( itr, same_payer, [&]( auto& rb ) {
          rb.vote_stake = current_stake;
+         rb.process_maturities( rex_maturity_days::day_of( current_time_point() ) );
       });
 
       update_rex_account( owner, asset( 0, core_symbol() ), current_stake - init_stake, true );
-      process_rex_maturities( itr );
    }
 
    void system_contract::setrex( const asset& balance )
@@ -276,10 +285,8 @@ namespace eosiosystem {
 
       check( balance.amount > 0, "balance must be set to have a positive amount" );
       check( balance.symbol == core_symbol(), "balance symbol must be core symbol" );
-      check( rex_system_initialized(), "rex system is not initialized" );
-      _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& pool ) {
-         pool.total_rent = balance;
-      });
+      check( rex_pool_initialized(), "rex system is not initialized" );
+      _rexpool->total_rent = balance;
    }
 
    void system_contract::rexexec( const name& user, uint16_t max )
@@ -287,13 +294,27 @@ namespace eosiosystem {
       require_auth( user );
 
       runrex( max );
+      update_rex_maintenance_due();
+   }
+
+   void system_contract::rexsettle( const name& user, uint16_t max )
+   {
+      require_auth( user );
+
+      /// filled orders are sorted last by the bytime index
+      auto idx = _rexorders.get_index<"bytime"_n>();
+      for ( uint16_t i = 0; i < max; ++i ) {
+         auto itr = idx.lower_bound( std::numeric_limits<uint64_t>::max() );
+         if ( itr == idx.end() ) break;
+         update_rex_account( itr->owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
+      }
    }
 
    void system_contract::consolidate( const name& owner )
    {
       require_auth( owner );
 
-      runrex(2);
+      run_due_rex_maintenance();
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       asset rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
@@ -304,24 +325,21 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      runrex(2);
+      run_due_rex_maintenance();
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const asset   rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
-      const int64_t rex_in_savings    = read_rex_savings( bitr );
-      check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= bitr->rex_balance.amount,
-             "insufficient REX balance" );
-      process_rex_maturities( bitr );
+      const asset rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         rb.process_maturities( rex_maturity_days::day_of( current_time_point() ) );
+         auto& days = *rb.maturity_days;
+         check( rex.amount + rex_in_sell_order.amount + days.savings <= rb.rex_balance.amount,
+                "insufficient REX balance" );
          int64_t moved_rex = 0;
-         while ( !rb.rex_maturities.empty() && moved_rex < rex.amount) {
-            const int64_t d_rex = std::min( rex.amount - moved_rex, rb.rex_maturities.back().second );
-            rb.rex_maturities.back().second -= d_rex;
-            moved_rex                       += d_rex;
-            if ( rb.rex_maturities.back().second == 0 ) {
-               rb.rex_maturities.pop_back();
-            }
+         for ( auto itr = days.maturing.rbegin(); itr != days.maturing.rend() && moved_rex < rex.amount; ++itr ) {
+            const int64_t d_rex = std::min( rex.amount - moved_rex, *itr );
+            *itr      -= d_rex;
+            moved_rex += d_rex;
          }
          if ( moved_rex < rex.amount ) {
             const int64_t d_rex = rex.amount - moved_rex;
@@ -330,30 +348,25 @@ namespace eosiosystem {
             check( rex_in_sell_order.amount <= rb.matured_rex, "logic error in mvtosavings" );
          }
          check( moved_rex == rex.amount, "programmer error in mvtosavings" );
+         days.savings += rex.amount;
       });
-      put_rex_savings( bitr, rex_in_savings + rex.amount );
    }
 
    void system_contract::mvfrsavings( const name& owner, const asset& rex )
    {
       require_auth( owner );
 
-      runrex(2);
+      run_due_rex_maintenance();
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      check( rex.amount <= rex_in_savings, "insufficient REX in savings" );
-      process_rex_maturities( bitr );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex.amount;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex.amount } );
-         }
+         rb.process_maturities( rex_maturity_days::day_of( current_time_point() ) );
+         auto& days = *rb.maturity_days;
+         check( rex.amount <= days.savings, "insufficient REX in savings" );
+         days.savings -= rex.amount;
+         rb.add_maturing_rex( rex_maturity_days::day_of( get_rex_maturity() ), rex.amount );
       });
-      put_rex_savings( bitr, rex_in_savings - rex.amount );
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
    }
 
@@ -361,8 +374,8 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      if ( rex_system_initialized() )
-         runrex(2);
+      if ( rex_pool_initialized() )
+         run_due_rex_maintenance();
 
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
 
@@ -404,7 +417,7 @@ namespace eosiosystem {
    void system_contract::donatetorex( const name& payer, const asset& quantity, const std::string& memo )
    {
       require_auth( payer );
-      check( rex_available(), "rex system is not initialized" );
+      check( rex_pool_available(), "rex system is not initialized" );
       check( quantity.symbol == core_symbol(), "quantity must be core token" );
       check( quantity.amount > 0, "quantity must be positive" );
 
@@ -472,15 +485,31 @@ namespace eosiosystem {
       }
    }
 
+   /**
+    * @brief Checks if the REX pool exists, as seen by the current action through the `_rexpool` cache
+    */
+   bool system_contract::rex_pool_initialized()
+   {
+      return _rexpool.exists();
+   }
+
+   /**
+    * @brief Checks if the REX pool exists and holds REX, as seen by the current action through the `_rexpool` cache
+    */
+   bool system_contract::rex_pool_available()
+   {
+      return _rexpool.exists() && _rexpool->total_rex.amount > 0;
+   }
+
    /**
     * @brief Checks if CPU and Network loans are available
     *
     * Loans are available if 1) REX pool lendable balance is nonempty, and 2) there are no
     * unfilled sellrex orders.
     */
-   bool system_contract::rex_loans_available()const
+   bool system_contract::rex_loans_available()
    {
-      if ( !rex_available() ) {
+      if ( !rex_pool_available() ) {
          return false;
       } else {
          if ( _rexorders.begin() == _rexorders.end() ) {
@@ -502,17 +531,16 @@ namespace eosiosystem {
    void system_contract::add_loan_to_rex_pool( const asset& payment, int64_t rented_tokens, bool new_loan )
    {
       channel_to_system_fees( get_self(), payment );
-      _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& rt ) {
-         // add payment to total_rent
-         rt.total_rent.amount    += payment.amount;
-         // move rented_tokens from total_unlent to total_lent
-         rt.total_unlent.amount  -= rented_tokens;
-         rt.total_lent.amount    += rented_tokens;
-         // increment loan_num if a new loan is being created
-         if ( new_loan ) {
-            rt.loan_num++;
-         }
-      });
+      auto& rt = *_rexpool;
+      // add payment to total_rent
+      rt.total_rent.amount    += payment.amount;
+      // move rented_tokens from total_unlent to total_lent
+      rt.total_unlent.amount  -= rented_tokens;
+      rt.total_lent.amount    += rented_tokens;
+      // increment loan_num if a new loan is being created
+      if ( new_loan ) {
+         rt.loan_num++;
+      }
    }
 
    /**
@@ -522,18 +550,16 @@ namespace eosiosystem {
     */
    void system_contract::remove_loan_from_rex_pool( const rex_loan& loan )
    {
-      const auto& pool = _rexpool.begin();
-      const int64_t delta_total_rent = exchange_state::get_bancor_output( pool->total_unlent.amount,
-                                                                          pool->total_rent.amount,
+      auto& rt = *_rexpool;
+      const int64_t delta_total_rent = exchange_state::get_bancor_output( rt.total_unlent.amount,
+                                                                          rt.total_rent.amount,
                                                                           loan.total_staked.amount );
-      _rexpool.modify( pool, same_payer, [&]( auto& rt ) {
-         // deduct calculated delta_total_rent from total_rent
-         rt.total_rent.amount    -= delta_total_rent;
-         // move rented tokens from total_lent to total_unlent
-         rt.total_unlent.amount  += loan.total_staked.amount;
-         rt.total_lent.amount    -= loan.total_staked.amount;
-         rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
-      });
+      // deduct calculated delta_total_rent from total_rent
+      rt.total_rent.amount    -= delta_total_rent;
+      // move rented tokens from total_lent to total_unlent
+      rt.total_unlent.amount  += loan.total_staked.amount;
+      rt.total_lent.amount    -= loan.total_staked.amount;
+      rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
    }
 
    /**
@@ -551,18 +577,84 @@ namespace eosiosystem {
       return delta_stake;
    }
 
+   /**
+    * @brief Performs REX maintenance on behalf of a REX action if any is due, as recorded in the REX maintenance
+    * singleton. Loans and sellrex orders processed by REX actions are limited by a per-block budget; the remaining
+    * backlog is processed in later blocks or by `rexexec`.
+    */
+   void system_contract::run_due_rex_maintenance()
+   {
+      check( rex_pool_initialized(), "rex system not initialized yet" );
+
+      if ( time_point_sec( current_time_point() ) < _rexmaint->next_due ) {
+         return;
+      }
+
+      const block_timestamp block = current_block_time();
+      const uint16_t used = _rexmaint->budget_block.slot == block.slot ? _rexmaint->budget_used : 0;
+
+      /// each of the three categories processes up to `max` loans or orders
+      const uint16_t remaining = rex_maintenance::block_budget - std::min( used, rex_maintenance::block_budget );
+      const uint16_t max       = std::min<uint16_t>( 2, remaining / 3 );
+
+      /// the budget is only charged, and the singleton only rewritten, when loans or orders were processed
+      if ( const uint32_t processed = runrex( max ); processed > 0 ) {
+         _rexmaint->budget_block = block;
+         _rexmaint->budget_used  = used + static_cast<uint16_t>( processed );
+      }
+
+      update_rex_maintenance_due();
+   }
+
+   /**
+    * @brief Records in the REX maintenance singleton the earliest time at which a loan expires, a sellrex order is
+    * queued or returns are distributed to the REX pool
+    */
+   void system_contract::update_rex_maintenance_due()
+   {
+      time_point_sec next_due = time_point_sec::maximum();
+
+      if ( _rexretpool.exists() ) {
+         next_due = std::min( next_due, _rexretpool->last_dist_time + rex_return_pool::dist_interval );
+      }
+
+      rex_cpu_loan_table cpu_loans( get_self(), get_self().value );
+      auto cpu_idx = cpu_loans.get_index<"byexpr"_n>();
+      if ( auto itr = cpu_idx.begin(); itr != cpu_idx.end() ) {
+         next_due = std::min( next_due, time_point_sec( itr->expiration ) );
+      }
+
+      rex_net_loan_table net_loans( get_self(), get_self().value );
+      auto net_idx = net_loans.get_index<"byexpr"_n>();
+      if ( auto itr = net_idx.begin(); itr != net_idx.end() ) {
+         next_due = std::min( next_due, time_point_sec( itr->expiration ) );
+      }
+
+      if ( _rexorders.begin() != _rexorders.end() ) {
+         auto idx = _rexorders.get_index<"bytime"_n>();
+         if ( idx.begin()->is_open ) {
+            next_due = time_point_sec::min(); /// queued sellrex orders are retried by every REX action
+         }
+      }
+
+      _rexmaint->next_due = next_due;
+   }
+
    /**
     * @brief Performs maintenance operations on expired NET and CPU loans and sellrex orders
     *
     * @param max - maximum number of each of the three categories to be processed
+    *
+    * @return uint32_t - number of loans and sellrex orders processed
     */
-   void system_contract::runrex( uint16_t max )
+   uint32_t system_contract::runrex( uint16_t max )
    {
-      check( rex_system_initialized(), "rex system not initialized yet" );
+      check( rex_pool_initialized(), "rex system not initialized yet" );
 
       update_rex_pool();
 
-      const auto& pool = _rexpool.begin();
+      const auto& pool = *_rexpool;
+      uint32_t processed = 0;
 
       auto process_expired_loan = [&]( auto& idx, const auto& itr ) -> std::pair<bool, int64_t> {
          /// update rex_pool in order to delete existing loan
@@ -570,8 +662,8 @@ namespace eosiosystem {
          bool    delete_loan   = false;
          int64_t delta_stake   = 0;
          /// calculate rented tokens at current price
-         int64_t rented_tokens = exchange_state::get_bancor_output( pool->total_rent.amount,
-                                                                    pool->total_unlent.amount,
+         int64_t rented_tokens = exchange_state::get_bancor_output( pool.total_rent.amount,
+                                                                    pool.total_unlent.amount,
                                                                     itr->payment.amount );
          /// conditions for loan renewal
          bool renew_loan = itr->payment <= itr->balance        /// loan has sufficient balance
@@ -594,6 +686,15 @@ namespace eosiosystem {
          return { delete_loan, delta_stake };
       };
 
+      /// resource limit changes of settled loans, applied once per receiver after all expired loans are processed
+      struct resource_delta {
+         name    receiver;
+         name    from;
+         int64_t net = 0;
+         int64_t cpu = 0;
+      };
+      std::vector<resource_delta> resource_deltas;
+
       /// process cpu loans
       {
          rex_cpu_loan_table cpu_loans( get_self(), get_self().value );
@@ -602,9 +703,10 @@ namespace eosiosystem {
             auto itr = cpu_idx.begin();
             if ( itr == cpu_idx.end() || itr->expiration > current_time_point() ) break;
 
+            ++processed;
             auto result = process_expired_loan( cpu_idx, itr );
             if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, 0, result.second );
+               resource_deltas.push_back( resource_delta{ itr->receiver, itr->from, 0, result.second } );
 
             if ( result.first )
                cpu_idx.erase( itr );
@@ -619,21 +721,36 @@ namespace eosiosystem {
             auto itr = net_idx.begin();
             if ( itr == net_idx.end() || itr->expiration > current_time_point() ) break;
 
+            ++processed;
             auto result = process_expired_loan( net_idx, itr );
             if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, result.second, 0 );
+               resource_deltas.push_back( resource_delta{ itr->receiver, itr->from, result.second, 0 } );
 
             if ( result.first )
                net_idx.erase( itr );
          }
       }
 
+      /// update resource limits of each receiver once, the payer of a new userres row being the first loan's payer
+      std::stable_sort( resource_deltas.begin(), resource_deltas.end(), []( const auto& a, const auto& b ) {
+         return a.receiver < b.receiver;
+      });
+      for ( auto itr = resource_deltas.begin(); itr != resource_deltas.end(); ) {
+         resource_delta total = *itr;
+         for ( ++itr; itr != resource_deltas.end() && itr->receiver == total.receiver; ++itr ) {
+            total.net += itr->net;
+            total.cpu += itr->cpu;
+         }
+         update_resource_limits( total.from, total.receiver, total.net, total.cpu );
+      }
+
       /// process sellrex orders
       if ( _rexorders.begin() != _rexorders.end() ) {
          auto idx  = _rexorders.get_index<"bytime"_n>();
          auto oitr = idx.begin();
          for ( uint16_t i = 0; i < max; ++i ) {
             if ( oitr == idx.end() || !oitr->is_open ) break;
+            ++processed;
             auto next = oitr;
             ++next;
             auto bitr = _rexbalance.find( oitr->owner.value );
@@ -655,10 +772,16 @@ namespace eosiosystem {
          }
       }
 
+      return processed;
    }
 
    /**
     * @brief Adds returns from the REX return pool to the REX pool
+    *
+    * Returns accrue linearly at `current_rate_of_increase` per distribution interval between bucket start and
+    * expiration times, so the amount due since `last_dist_time` is computed in one step whatever the number of
+    * elapsed intervals: the running rate times the elapsed intervals, plus the accrual of the new bucket since
+    * its start, minus the accrual of expired buckets since their expiration.
     */
    void system_contract::update_rex_pool()
    {
@@ -670,103 +793,123 @@ namespace eosiosystem {
       const uint32_t       cts            = ct.sec_since_epoch();
       const time_point_sec effective_time{cts - cts % rex_return_pool::dist_interval};
 
-      const auto ret_pool_elem    = _rexretpool.begin();
-      const auto ret_buckets_elem = _rexretbuckets.begin();
-
-      if ( ret_pool_elem == _rexretpool.end() || effective_time <= ret_pool_elem->last_dist_time ) {
+      if ( !_rexretpool.exists() || effective_time <= _rexretpool->last_dist_time ) {
          return;
       }
 
-      const int64_t  current_rate      = ret_pool_elem->current_rate_of_increase;
-      const uint32_t elapsed_intervals = get_elapsed_intervals( effective_time, ret_pool_elem->last_dist_time );
+      auto& rp = *_rexretpool;
+
+      const int64_t  current_rate      = rp.current_rate_of_increase;
+      const uint32_t elapsed_intervals = get_elapsed_intervals( effective_time, rp.last_dist_time );
       int64_t        change_estimate   = current_rate * elapsed_intervals;
 
+      const time_point_sec time_threshold = effective_time - seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval);
+      int64_t expired_rate = 0;
+      int64_t surplus      = 0;
+      auto expire_bucket = [&]( pair_time_point_sec_int64& bucket ) {
+         const uint32_t overtime = get_elapsed_intervals( effective_time,
+                                                          bucket.first + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
+         surplus      += bucket.second * overtime;
+         expired_rate += bucket.second;
+         bucket        = pair_time_point_sec_int64{};
+      };
+
+      const bool new_return_bucket = rp.pending_bucket_time <= effective_time;
       {
-         const bool new_return_bucket = ret_pool_elem->pending_bucket_time <= effective_time;
          int64_t        new_bucket_rate = 0;
          time_point_sec new_bucket_time = time_point_sec::min();
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            if ( new_return_bucket ) {
-               int64_t remainder = rp.pending_bucket_proceeds % rex_return_pool::total_intervals;
-               new_bucket_rate   = ( rp.pending_bucket_proceeds - remainder ) / rex_return_pool::total_intervals;
-               new_bucket_time   = rp.pending_bucket_time;
-               rp.current_rate_of_increase += new_bucket_rate;
-               change_estimate             += remainder + new_bucket_rate * get_elapsed_intervals( effective_time, rp.pending_bucket_time );
-               rp.pending_bucket_proceeds   = 0;
-               rp.pending_bucket_time       = time_point_sec::maximum();
-               if ( new_bucket_time < rp.oldest_bucket_time ) {
-                  rp.oldest_bucket_time = new_bucket_time;
-               }
+         if ( new_return_bucket ) {
+            int64_t remainder = rp.pending_bucket_proceeds % rex_return_pool::total_intervals;
+            new_bucket_rate   = ( rp.pending_bucket_proceeds - remainder ) / rex_return_pool::total_intervals;
+            new_bucket_time   = rp.pending_bucket_time;
+            rp.current_rate_of_increase += new_bucket_rate;
+            change_estimate             += remainder + new_bucket_rate * get_elapsed_intervals( effective_time, rp.pending_bucket_time );
+            rp.pending_bucket_proceeds   = 0;
+            rp.pending_bucket_time       = time_point_sec::maximum();
+            if ( new_bucket_time < rp.oldest_bucket_time ) {
+               rp.oldest_bucket_time = new_bucket_time;
             }
-            rp.proceeds      -= change_estimate;
-            rp.last_dist_time = effective_time;
-         });
+         }
+         rp.proceeds      -= change_estimate;
+         rp.last_dist_time = effective_time;
 
          if ( new_return_bucket ) {
-            _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-               auto iter = std::lower_bound(rb.return_buckets.begin(), rb.return_buckets.end(), new_bucket_time, [](const pair_time_point_sec_int64& bucket, time_point_sec first) {
-                  return bucket.first < first;
-               });
-               if ((iter != rb.return_buckets.end()) && (iter->first == new_bucket_time)) {
-                  iter->second = new_bucket_rate;
-               } else {
-                  rb.return_buckets.insert(iter, pair_time_point_sec_int64{new_bucket_time, new_bucket_rate});
-               }
-            });
+            migrate_rex_return_buckets();
+            auto& bucket = _rexretring->buckets[rex_return_ring::slot( new_bucket_time )];
+            if ( bucket.first != new_bucket_time && bucket.first != time_point_sec::min() ) {
+               /// a slot is reused 30 days after the bucket it holds, which has therefore expired
+               expire_bucket( bucket );
+            }
+            bucket = pair_time_point_sec_int64{ new_bucket_time, new_bucket_rate };
          }
       }
 
-      const time_point_sec time_threshold = effective_time - seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval);
-      if ( ret_pool_elem->oldest_bucket_time <= time_threshold ) {
-         int64_t expired_rate = 0;
-         int64_t surplus      = 0;
-         _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-            auto& return_buckets = rb.return_buckets;
-            auto iter = return_buckets.begin();
-            for (; iter != return_buckets.end() && iter->first <= time_threshold; ++iter) {
-               const uint32_t overtime = get_elapsed_intervals( effective_time,
-                                                                iter->first + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
-               surplus      += iter->second * overtime;
-               expired_rate += iter->second;
-            }
-            return_buckets.erase(return_buckets.begin(), iter);
-         });
-
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            if ( !ret_buckets_elem->return_buckets.empty() ) {
-               rp.oldest_bucket_time = ret_buckets_elem->return_buckets.begin()->first;
-            } else {
-               rp.oldest_bucket_time = time_point_sec::min();
-            }
-            if ( expired_rate > 0) {
-               rp.current_rate_of_increase -= expired_rate;
+      if ( rp.oldest_bucket_time <= time_threshold ) {
+         /// oldest_bucket_time is only left at its minimum when there are no buckets
+         time_point_sec oldest = time_point_sec::min();
+         if ( new_return_bucket || rp.oldest_bucket_time != time_point_sec::min() ) {
+            migrate_rex_return_buckets();
+            oldest = time_point_sec::maximum();
+            for ( auto& bucket : _rexretring->buckets ) {
+               if ( bucket.first == time_point_sec::min() ) {
+                  continue;
+               } else if ( bucket.first <= time_threshold ) {
+                  expire_bucket( bucket );
+               } else if ( bucket.first < oldest ) {
+                  oldest = bucket.first;
+               }
             }
-            if ( surplus > 0 ) {
-               change_estimate -= surplus;
-               rp.proceeds     += surplus;
+            if ( oldest == time_point_sec::maximum() ) {
+               oldest = time_point_sec::min();
             }
-         });
+         }
+         rp.oldest_bucket_time = oldest;
       }
 
-      if ( change_estimate > 0 && ret_pool_elem->proceeds < 0 ) {
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            change_estimate += rp.proceeds;
-            rp.proceeds      = 0;
-         });
+      if ( expired_rate > 0) {
+         rp.current_rate_of_increase -= expired_rate;
+      }
+      if ( surplus > 0 ) {
+         change_estimate -= surplus;
+         rp.proceeds     += surplus;
+      }
+
+      if ( change_estimate > 0 && rp.proceeds < 0 ) {
+         change_estimate += rp.proceeds;
+         rp.proceeds      = 0;
       }
 
       if ( change_estimate > 0 ) {
-         _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& pool ) {
-            pool.total_unlent.amount += change_estimate;
-            pool.total_lendable       = pool.total_unlent + pool.total_lent;
-         });
+         auto& pool = *_rexpool;
+         pool.total_unlent.amount += change_estimate;
+         pool.total_lendable       = pool.total_unlent + pool.total_lent;
+      }
+   }
+
+   /**
+    * @brief Creates the REX return ring, moving into it the buckets of the `rex_return_buckets` table used
+    * before version 3.11.0
+    */
+   void system_contract::migrate_rex_return_buckets()
+   {
+      if ( _rexretring.exists() ) {
+         return;
       }
+
+      rex_return_ring ring;
+      if ( auto itr = _rexretbuckets.begin(); itr != _rexretbuckets.end() ) {
+         for ( const auto& bucket : itr->return_buckets ) {
+            ring.buckets[rex_return_ring::slot( bucket.first )] = bucket;
+         }
+         _rexretbuckets.erase( itr );
+      }
+      _rexretring.emplace( get_self(), ring );
    }
 
    template <typename T>
    int64_t system_contract::rent_rex( T& table, const name& from, const name& receiver, const asset& payment, const asset& fund )
    {
-      runrex(2);
+      run_due_rex_maintenance();
 
       check( rex_loans_available(), "rex loans are currently not available" );
       check( payment.symbol == core_symbol() && fund.symbol == core_symbol(), "must use core token" );
@@ -774,10 +917,10 @@ namespace eosiosystem {
 
       transfer_from_fund( from, payment + fund );
 
-      const auto& pool = _rexpool.begin(); /// already checked that _rexpool.begin() != _rexpool.end() in rex_loans_available()
+      const auto& pool = *_rexpool; /// already checked that the REX pool exists in rex_loans_available()
 
-      int64_t rented_tokens = exchange_state::get_bancor_output( pool->total_rent.amount,
-                                                                 pool->total_unlent.amount,
+      int64_t rented_tokens = exchange_state::get_bancor_output( pool.total_rent.amount,
+                                                                 pool.total_unlent.amount,
                                                                  payment.amount );
       check( payment.amount < rented_tokens, "loan price does not favor renting" );
       add_loan_to_rex_pool( payment, rented_tokens, true );
@@ -789,8 +932,9 @@ namespace eosiosystem {
          c.balance      = fund;
          c.total_staked = asset( rented_tokens, core_symbol() );
          c.expiration   = current_time_point() + eosio::days(30);
-         c.loan_num     = pool->loan_num;
+         c.loan_num     = pool.loan_num;
       });
+      _rexmaint->next_due = std::min( _rexmaint->next_due, time_point_sec( current_time_point() + eosio::days(30) ) );
 
       rex_results::rentresult_action rentresult_act{ rex_account, std::vector<eosio::permission_level>{ } };
       rentresult_act.send( asset{ rented_tokens, core_symbol() } );
@@ -817,11 +961,12 @@ namespace eosiosystem {
     * @return rex_order_outcome - a struct containing success flag, order proceeds, and resultant
     * vote stake change
     */
-   rex_order_outcome system_contract::fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex )
+   rex_order_outcome system_contract::fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex,
+                                                      bool process_maturities )
    {
-      auto rexpool_itr = _rexpool.begin();
-      const int64_t S0 = rexpool_itr->total_lendable.amount;
-      const int64_t R0 = rexpool_itr->total_rex.amount;
+      auto& pool = *_rexpool;
+      const int64_t S0 = pool.total_lendable.amount;
+      const int64_t R0 = pool.total_rex.amount;
       const int64_t p  = (uint128_t(rex.amount) * S0) / R0;
       const int64_t R1 = R0 - rex.amount;
       const int64_t S1 = S0 - p;
@@ -829,17 +974,21 @@ namespace eosiosystem {
       asset stake_change( 0, core_symbol() );
       bool  success = false;
 
-      const int64_t unlent_lower_bound = rexpool_itr->total_lent.amount / 10;
-      const int64_t available_unlent   = rexpool_itr->total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
+      const int64_t unlent_lower_bound = pool.total_lent.amount / 10;
+      const int64_t available_unlent   = pool.total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
       if ( proceeds.amount <= available_unlent ) {
          const int64_t init_vote_stake_amount = bitr->vote_stake.amount;
          const int64_t current_stake_value    = ( uint128_t(bitr->rex_balance.amount) * S0 ) / R0;
-         _rexpool.modify( rexpool_itr, same_payer, [&]( auto& rt ) {
-            rt.total_rex.amount      = R1;
-            rt.total_lendable.amount = S1;
-            rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
-         });
+         pool.total_rex.amount      = R1;
+         pool.total_lendable.amount = S1;
+         pool.total_unlent.amount   = pool.total_lendable.amount - pool.total_lent.amount;
+         if ( R1 == 0 ) {
+            update_system_status(); /// all REX has been sold, REX pool is now empty
+         }
          _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+            if ( process_maturities ) {
+               rb.process_maturities( rex_maturity_days::day_of( current_time_point() ) );
+            }
             rb.vote_stake.amount   = current_stake_value - proceeds.amount;
             rb.rex_balance.amount -= rex.amount;
             rb.matured_rex        -= rex.amount;
@@ -976,19 +1125,68 @@ namespace eosiosystem {
    }
 
    /**
-    * @brief Updates REX owner maturity buckets
+    * @brief Updates REX owner maturity buckets, converting them to the day-indexed layout of version 1
+    * if needed
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * Maturities fall at the start of a day. A version 0 maturity within a day, which `get_rex_maturity`
+    * never produces, is deferred to the start of the next day.
+    *
+    * @param day - current day, counted from the epoch
     */
-   void system_contract::process_rex_maturities( const rex_balance_table::const_iterator& bitr )
+   void rex_balance::process_maturities( uint32_t day )
    {
-      const time_point_sec now = current_time_point();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         while ( !rb.rex_maturities.empty() && rb.rex_maturities.front().first <= now ) {
-            rb.matured_rex += rb.rex_maturities.front().second;
-            rb.rex_maturities.erase(rb.rex_maturities.begin());
+      if ( !maturity_days.has_value() ) {
+         rex_maturity_days days;
+         days.base_day = day;
+         for ( const auto& bucket : rex_maturities ) {
+            if ( bucket.first == time_point_sec::maximum() ) {
+               days.savings += bucket.second;
+               continue;
+            }
+            const uint32_t maturity_day = ( bucket.first.sec_since_epoch() + seconds_per_day - 1 ) / seconds_per_day;
+            if ( maturity_day <= day ) {
+               matured_rex += bucket.second;
+            } else {
+               if ( days.maturing.size() < maturity_day - day ) {
+                  days.maturing.resize( maturity_day - day );
+               }
+               days.maturing[maturity_day - day - 1] += bucket.second;
+            }
          }
-      });
+         rex_maturities.clear();
+         maturity_days.emplace( std::move(days) );
+         version = 1;
+         return;
+      }
+
+      auto& days = maturity_days.value();
+      if ( day <= days.base_day ) {
+         return;
+      }
+      const size_t matured = std::min<size_t>( day - days.base_day, days.maturing.size() );
+      for ( size_t i = 0; i < matured; ++i ) {
+         matured_rex += days.maturing[i];
+      }
+      std::move( days.maturing.begin() + matured, days.maturing.end(), days.maturing.begin() );
+      std::fill( days.maturing.end() - matured, days.maturing.end(), 0 );
+      days.base_day = day;
+   }
+
+   /**
+    * @brief Adds REX to the maturity bucket of a given day, the maturity buckets having been processed
+    * beforehand
+    *
+    * @param day - maturity day, counted from the epoch
+    * @param rex - amount of REX maturing
+    */
+   void rex_balance::add_maturing_rex( uint32_t day, int64_t rex )
+   {
+      auto& days = maturity_days.value();
+      check( days.base_day < day, "maturity day must follow processed maturities" );
+      if ( days.maturing.size() < day - days.base_day ) {
+         days.maturing.resize( day - days.base_day );
+      }
+      days.maturing[day - days.base_day - 1] += rex;
    }
 
    /**
@@ -1032,19 +1230,39 @@ namespace eosiosystem {
    void system_contract::consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                                   const asset& rex_in_sell_order )
    {
-      const int64_t rex_in_savings = read_rex_savings( bitr );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         rb.process_maturities( rex_maturity_days::day_of( current_time_point() ) );
          int64_t total  = rb.matured_rex - rex_in_sell_order.amount;
          rb.matured_rex = rex_in_sell_order.amount;
-         while ( !rb.rex_maturities.empty() ) {
-            total += rb.rex_maturities.front().second;
-            rb.rex_maturities.erase(rb.rex_maturities.begin());
+         for ( auto& rex : rb.maturity_days->maturing ) {
+            total += rex;
+            rex    = 0;
          }
          if ( total > 0 ) {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ get_rex_maturity(), total } );
+            rb.add_maturing_rex( rex_maturity_days::day_of( get_rex_maturity() ), total );
          }
       });
-      put_rex_savings( bitr, rex_in_savings );
+   }
+
+   /**
+    * @brief Updates the `system_status` singleton with the current state of the REX pool, writing it only
+    * if it is absent or has changed
+    */
+   void system_contract::update_system_status()
+   {
+      system_status_singleton status_sing( get_self(), get_self().value );
+      const bool exists = status_sing.exists();
+      auto status = exists ? status_sing.get() : system_status{ get_core_symbol( get_self() ) };
+
+      const bool rex_initialized = rex_pool_initialized();
+      const bool rex_available   = rex_pool_available();
+      if ( exists && status.rex_initialized == rex_initialized && status.rex_available == rex_available ) {
+         return;
+      }
+
+      status.rex_initialized = rex_initialized;
+      status.rex_available   = rex_available;
+      status_sing.set( status, get_self() );
    }
 
    /**
@@ -1067,42 +1285,40 @@ namespace eosiosystem {
       const int64_t rex_ratio = 10000;
       const asset   init_total_rent( 20'000'0000, core_symbol() ); /// base balance prevents renting profitably until at least a minimum number of core_symbol() is made available
       asset rex_received( 0, rex_symbol );
-      auto itr = _rexpool.begin();
-      if ( !rex_system_initialized() ) {
+      if ( !rex_pool_initialized() ) {
          /// initialize REX pool
-         _rexpool.emplace( get_self(), [&]( auto& rp ) {
-            rex_received.amount = payment.amount * rex_ratio;
-            rp.total_lendable   = payment;
-            rp.total_lent       = asset( 0, core_symbol() );
-            rp.total_unlent     = rp.total_lendable - rp.total_lent;
-            rp.total_rent       = init_total_rent;
-            rp.total_rex        = rex_received;
-            rp.namebid_proceeds = asset( 0, core_symbol() );
-         });
-      } else if ( !rex_available() ) { /// should be a rare corner case, REX pool is initialized but empty
-         _rexpool.modify( itr, same_payer, [&]( auto& rp ) {
-            rex_received.amount      = payment.amount * rex_ratio;
-            rp.total_lendable.amount = payment.amount;
-            rp.total_lent.amount     = 0;
-            rp.total_unlent.amount   = rp.total_lendable.amount - rp.total_lent.amount;
-            rp.total_rent.amount     = init_total_rent.amount;
-            rp.total_rex.amount      = rex_received.amount;
-         });
+         rex_pool rp;
+         rex_received.amount = payment.amount * rex_ratio;
+         rp.total_lendable   = payment;
+         rp.total_lent       = asset( 0, core_symbol() );
+         rp.total_unlent     = rp.total_lendable - rp.total_lent;
+         rp.total_rent       = init_total_rent;
+         rp.total_rex        = rex_received;
+         rp.namebid_proceeds = asset( 0, core_symbol() );
+         _rexpool.emplace( get_self(), rp );
+      } else if ( !rex_pool_available() ) { /// should be a rare corner case, REX pool is initialized but empty
+         auto& rp = *_rexpool;
+         rex_received.amount      = payment.amount * rex_ratio;
+         rp.total_lendable.amount = payment.amount;
+         rp.total_lent.amount     = 0;
+         rp.total_unlent.amount   = rp.total_lendable.amount - rp.total_lent.amount;
+         rp.total_rent.amount     = init_total_rent.amount;
+         rp.total_rex.amount      = rex_received.amount;
       } else {
+         auto& rp = *_rexpool;
          /// total_lendable > 0 if total_rex > 0 except in a rare case and due to rounding errors
-         check( itr->total_lendable.amount > 0, "lendable REX pool is empty" );
-         const int64_t S0 = itr->total_lendable.amount;
+         check( rp.total_lendable.amount > 0, "lendable REX pool is empty" );
+         const int64_t S0 = rp.total_lendable.amount;
          const int64_t S1 = S0 + payment.amount;
-         const int64_t R0 = itr->total_rex.amount;
+         const int64_t R0 = rp.total_rex.amount;
          const int64_t R1 = (uint128_t(S1) * R0) / S0;
          rex_received.amount = R1 - R0;
-         _rexpool.modify( itr, same_payer, [&]( auto& rp ) {
-            rp.total_lendable.amount = S1;
-            rp.total_rex.amount      = R1;
-            rp.total_unlent.amount   = rp.total_lendable.amount - rp.total_lent.amount;
-            check( rp.total_unlent.amount >= 0, "programmer error, this should never go negative" );
-         });
+         rp.total_lendable.amount = S1;
+         rp.total_rex.amount      = R1;
+         rp.total_unlent.amount   = rp.total_lendable.amount - rp.total_lent.amount;
+         check( rp.total_unlent.amount >= 0, "programmer error, this should never go negative" );
       }
+      update_system_status(); /// also creates the status on chains initialized before it existed
 
       return rex_received;
    }
@@ -1123,23 +1339,22 @@ namespace eosiosystem {
       const uint32_t       cts             = ct.sec_since_epoch();
       const uint32_t       bucket_interval = rex_return_pool::hours_per_bucket * seconds_per_hour;
       const time_point_sec effective_time{cts - cts % bucket_interval + bucket_interval};
-      const auto return_pool_elem = _rexretpool.begin();
-      if ( return_pool_elem == _rexretpool.end() ) {
-         _rexretpool.emplace( get_self(), [&]( auto& rp ) {
-            rp.last_dist_time          = effective_time;
-            rp.pending_bucket_proceeds = fee.amount;
-            rp.pending_bucket_time     = effective_time;
-            rp.proceeds                = fee.amount;
-         });
-         _rexretbuckets.emplace( get_self(), [&]( auto& rb ) { } );
+      if ( !_rexretpool.exists() ) {
+         rex_return_pool rp;
+         rp.last_dist_time          = effective_time;
+         rp.pending_bucket_proceeds = fee.amount;
+         rp.pending_bucket_time     = effective_time;
+         rp.proceeds                = fee.amount;
+         _rexretpool.emplace( get_self(), rp );
+         migrate_rex_return_buckets();
+         _rexmaint->next_due = std::min( _rexmaint->next_due, effective_time + rex_return_pool::dist_interval );
       } else {
-         _rexretpool.modify( return_pool_elem, same_payer, [&]( auto& rp ) {
-            rp.pending_bucket_proceeds += fee.amount;
-            rp.proceeds                += fee.amount;
-            if ( rp.pending_bucket_time == time_point_sec::maximum() ) {
-               rp.pending_bucket_time = effective_time;
-            }
-         });
+         auto& rp = *_rexretpool;
+         rp.pending_bucket_proceeds += fee.amount;
+         rp.proceeds                += fee.amount;
+         if ( rp.pending_bucket_time == time_point_sec::maximum() ) {
+            rp.pending_bucket_time = effective_time;
+         }
       }
    }
 
@@ -1156,81 +1371,33 @@ namespace eosiosystem {
    {
       asset init_rex_stake( 0, core_symbol() );
       asset current_rex_stake( 0, core_symbol() );
+      const uint32_t today        = rex_maturity_days::day_of( current_time_point() );
+      const uint32_t maturity_day = rex_maturity_days::day_of( get_rex_maturity() );
       auto bitr = _rexbalance.find( owner.value );
       if ( bitr == _rexbalance.end() ) {
-         bitr = _rexbalance.emplace( owner, [&]( auto& rb ) {
+         _rexbalance.emplace( owner, [&]( auto& rb ) {
             rb.owner       = owner;
             rb.vote_stake  = payment;
             rb.rex_balance = rex_received;
+            rb.process_maturities( today );
+            rb.add_maturing_rex( maturity_day, rex_received.amount );
          });
          current_rex_stake.amount = payment.amount;
       } else {
          init_rex_stake.amount = bitr->vote_stake.amount;
          _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
             rb.rex_balance.amount += rex_received.amount;
-            rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
-                                     / _rexpool.begin()->total_rex.amount;
+            rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool->total_lendable.amount )
+                                     / _rexpool->total_rex.amount;
+            rb.process_maturities( today );
+            rb.add_maturing_rex( maturity_day, rex_received.amount );
          });
          current_rex_stake.amount = bitr->vote_stake.amount;
       }
 
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex_received.amount;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex_received.amount } );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings );
       return current_rex_stake - init_rex_stake;
    }
 
-   /**
-    * @brief Reads amount of REX in savings bucket and removes the bucket from maturities
-    *
-    * Reads and (temporarily) removes REX savings bucket from REX maturities in order to
-    * allow uniform processing of remaining buckets as savings is a special case. This
-    * function is used in conjunction with put_rex_savings.
-    *
-    * @param bitr - iterator pointing to rex_balance object
-    *
-    * @return int64_t - amount of REX in savings bucket
-    */
-   int64_t system_contract::read_rex_savings( const rex_balance_table::const_iterator& bitr )
-   {
-      int64_t rex_in_savings = 0;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      if ( !bitr->rex_maturities.empty() && bitr->rex_maturities.back().first == end_of_days ) {
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rex_in_savings = rb.rex_maturities.back().second;
-            rb.rex_maturities.pop_back();
-         });
-      }
-      return rex_in_savings;
-   }
-
-   /**
-    * @brief Adds a specified REX amount to savings bucket
-    *
-    * @param bitr - iterator pointing to rex_balance object
-    * @param rex - amount of REX to be added
-    */
-   void system_contract::put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex )
-   {
-      if ( rex == 0 ) return;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
-            rb.rex_maturities.back().second += rex;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ end_of_days, rex } );
-         }
-      });
-   }
-
    /**
     * @brief Updates voter REX vote stake to the current value of REX tokens held
     *
@@ -1240,11 +1407,11 @@ namespace eosiosystem {
    {
       int64_t delta_stake = 0;
       auto bitr = _rexbalance.find( voter.value );
-      if ( bitr != _rexbalance.end() && rex_available() ) {
+      if ( bitr != _rexbalance.end() && rex_pool_available() ) {
          asset init_vote_stake = bitr->vote_stake;
          asset current_vote_stake( 0, core_symbol() );
-         current_vote_stake.amount = ( uint128_t(bitr->rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
-                                     / _rexpool.begin()->total_rex.amount;
+         current_vote_stake.amount = ( uint128_t(bitr->rex_balance.amount) * _rexpool->total_lendable.amount )
+                                     / _rexpool->total_rex.amount;
          _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
             rb.vote_stake.amount = current_vote_stake.amount;
          });
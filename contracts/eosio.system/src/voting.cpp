@@ -8,6 +8,7 @@
 #include <eosio/singleton.hpp>
 
 #include <eosio.system/eosio.system.hpp>
+#include <eosio.system/vote_weight.hpp>
 #include <eosio.token/eosio.token.hpp>
 
 #include <type_traits>
@@ -38,6 +39,10 @@ namespace eosiosystem {
       }, producer_authority );
 
       if ( prod != _producers.end() ) {
+         // producers registered before version 3.11.0 keep their votepay share in the producers2 table until migrated here
+         const bool migrate_votepay_state = !prod->votepay_state.has_value();
+         auto prod2 = migrate_votepay_state ? _producers2.find( producer.value ) : _producers2.end();
+
          _producers.modify( prod, producer, [&]( producer_info& info ){
             info.producer_key       = producer_key;
             info.is_active          = true;
@@ -46,16 +51,19 @@ namespace eosiosystem {
             info.producer_authority.emplace( producer_authority );
             if ( info.last_claim_time == time_point() )
                info.last_claim_time = ct;
+            if ( migrate_votepay_state ) {
+               if ( prod2 != _producers2.end() )
+                  info.votepay_state.emplace( producer_votepay_state{ prod2->votepay_share, prod2->last_votepay_share_update } );
+               else
+                  info.votepay_state.emplace( producer_votepay_state{ 0.0, ct } );
+            }
          });
 
-         auto prod2 = _producers2.find( producer.value );
-         if ( prod2 == _producers2.end() ) {
-            _producers2.emplace( producer, [&]( producer_info2& info ){
-               info.owner                     = producer;
-               info.last_votepay_share_update = ct;
-            });
+         if ( prod2 != _producers2.end() ) {
+            _producers2.erase( prod2 );
+         } else if ( migrate_votepay_state ) {
             update_total_votepay_share( ct, 0.0, prod->total_votes );
-            // When introducing the producer2 table row for the first time, the producer's votes must also be accounted for in the global total_producer_votepay_share at the same time.
+            // When introducing the votepay state for the first time, the producer's votes must also be accounted for in the global total_producer_votepay_share at the same time.
          }
       } else {
          _producers.emplace( producer, [&]( producer_info& info ){
@@ -67,13 +75,11 @@ namespace eosiosystem {
             info.location           = location;
             info.last_claim_time    = ct;
             info.producer_authority.emplace( producer_authority );
-         });
-         _producers2.emplace( producer, [&]( producer_info2& info ){
-            info.owner                     = producer;
-            info.last_votepay_share_update = ct;
+            info.votepay_state.emplace( producer_votepay_state{ 0.0, ct } );
          });
       }
 
+      invalidate_producer_ranking();
    }
 
    void system_contract::regproducer( const name& producer, const eosio::public_key& producer_key, const std::string& url, uint16_t location ) {
@@ -101,10 +107,44 @@ namespace eosiosystem {
       _producers.modify( prod, same_payer, [&]( producer_info& info ){
          info.deactivate();
       });
+      invalidate_producer_ranking();
+   }
+
+   void system_contract::invalidate_producer_ranking() {
+      _gstate2->producer_ranking_unchanged.emplace( false );
+   }
+
+   /**
+    * Invalidates the producer ranking if a producer whose votes change from `old_votes` to `new_votes` could join or
+    * leave the producers elected at the last schedule update. Otherwise the vote bounds of the elected producers and
+    * of the producers left out are widened to include `new_votes`, so that they keep holding.
+    */
+   void system_contract::track_producer_votes( double old_votes, double new_votes ) {
+      if( !_gstate2->lowest_elected_votes.has_value() || !_gstate2->highest_unelected_votes.has_value() ) {
+         invalidate_producer_ranking();
+         return;
+      }
+      double& lowest_elected    = _gstate2->lowest_elected_votes.value();
+      double& highest_unelected = _gstate2->highest_unelected_votes.value();
+      if( highest_unelected < old_votes && highest_unelected < new_votes ) {
+         // elected (or not eligible) before and still ahead of every producer left out
+         lowest_elected = std::min( lowest_elected, new_votes );
+      } else if( old_votes < lowest_elected && new_votes < lowest_elected ) {
+         // left out before and still behind every elected producer
+         highest_unelected = std::max( highest_unelected, new_votes );
+      } else {
+         invalidate_producer_ranking();
+      }
    }
 
    void system_contract::update_elected_producers( const block_timestamp& block_time ) {
-      _gstate.last_producer_schedule_update = block_time;
+      _gstate->last_producer_schedule_update = block_time;
+
+      // nothing that could change the proposed producers or finalizers has happened since the last evaluation
+      if( _gstate2->producer_ranking_unchanged.has_value() && _gstate2->producer_ranking_unchanged.value() ) {
+         return;
+      }
+      _gstate2->producer_ranking_unchanged.emplace( true );
 
       auto idx = _producers.get_index<"prototalvote"_n>();
 
@@ -115,8 +155,11 @@ namespace eosiosystem {
       proposed_finalizers.reserve(21);
 
       bool is_savanna = is_savanna_consensus();
+      double lowest_elected_votes    = 0;
+      double highest_unelected_votes = 0;
 
-      for( auto it = idx.cbegin(); it != idx.cend() && top_producers.size() < 21 && 0 < it->total_votes && it->active(); ++it ) {
+      auto it = idx.cbegin();
+      for( ; it != idx.cend() && top_producers.size() < 21 && 0 < it->total_votes && it->active(); ++it ) {
          if( is_savanna ) {
             auto finalizer = _finalizers.find( it->owner.value );
             if( finalizer == _finalizers.end() ) {
@@ -140,9 +183,33 @@ namespace eosiosystem {
             },
             it->location
          );
+         lowest_elected_votes = it->total_votes;
       }
 
-      if( top_producers.size() == 0 || top_producers.size() < _gstate.last_producer_schedule_size ) {
+      // While fewer than 21 producers are elected, every eligible producer with votes is, so any producer
+      // getting votes may join. Otherwise the first eligible producer left out bounds the others.
+      if( top_producers.size() < 21 ) {
+         lowest_elected_votes = 0;
+      }
+      for( ; top_producers.size() == 21 && it != idx.cend() && 0 < it->total_votes && it->active(); ++it ) {
+         if( is_savanna ) {
+            auto finalizer = _finalizers.find( it->owner.value );
+            if( finalizer == _finalizers.end() || finalizer->active_key_binary.empty() ) {
+               continue;
+            }
+         }
+         highest_unelected_votes = it->total_votes;
+         break;
+      }
+      // Binary extensions are serialized in order, so the hash which precedes the vote bounds needs a value. An all-zero
+      // hash, which no schedule has, stands for none recorded yet.
+      if( !_gstate2->last_proposed_producers_hash.has_value() ) {
+         _gstate2->last_proposed_producers_hash.emplace();
+      }
+      _gstate2->lowest_elected_votes.emplace( lowest_elected_votes );
+      _gstate2->highest_unelected_votes.emplace( highest_unelected_votes );
+
+      if( top_producers.size() == 0 || top_producers.size() < _gstate->last_producer_schedule_size ) {
          return;
       }
 
@@ -157,8 +224,17 @@ namespace eosiosystem {
       for( auto& item : top_producers )
          producers.push_back( std::move(item.first) );
 
+      const auto packed_producers = eosio::pack( producers );
+      const auto producers_hash   = eosio::sha256( packed_producers.data(), packed_producers.size() );
+
       if( set_proposed_producers( producers ) >= 0 ) {
-         _gstate.last_producer_schedule_size = static_cast<decltype(_gstate.last_producer_schedule_size)>( producers.size() );
+         _gstate->last_producer_schedule_size = static_cast<decltype(_gstate->last_producer_schedule_size)>( producers.size() );
+         _gstate2->last_proposed_producers_hash.emplace( producers_hash );
+      } else if( _gstate2->last_proposed_producers_hash.value() != producers_hash ) {
+         // The schedule could not be proposed (e.g. because an earlier proposal is still pending) and differs from the
+         // last one proposed, or no schedule was recorded since an upgrade from a version which didn't record the
+         // hash, so the ranking has to be evaluated again at the next schedule update.
+         invalidate_producer_ranking();
       }
 
       // set_proposed_finalizers() checks if last proposed finalizer policy
@@ -169,9 +245,13 @@ namespace eosiosystem {
    }
 
    double stake2vote( int64_t staked ) {
+      // The multiplier only changes weekly and current_time_point() is fixed for the whole action, so it is computed
+      // once per action rather than once per voter and proxy hop.
       /// TODO subtract 2080 brings the large numbers closer to this decade
-      double weight = int64_t( (current_time_point().sec_since_epoch() - (block_timestamp::block_timestamp_epoch / 1000)) / (seconds_per_day * 7) )  / double( 52 );
-      return double(staked) * std::pow( 2, weight );
+      const static double multiplier = vote_weight::multiplier(
+         int64_t( (current_time_point().sec_since_epoch() - (block_timestamp::block_timestamp_epoch / 1000)) / (seconds_per_day * 7) )
+      );
+      return double(staked) * multiplier;
    }
 
    double system_contract::update_total_votepay_share( const time_point& ct,
@@ -179,50 +259,88 @@ namespace eosiosystem {
                                                        double shares_rate_delta )
    {
       double delta_total_votepay_share = 0.0;
-      if( ct > _gstate3.last_vpay_state_update ) {
-         delta_total_votepay_share = _gstate3.total_vpay_share_change_rate
-                                       * double( (ct - _gstate3.last_vpay_state_update).count() / 1E6 );
+      if( ct > _gstate3->last_vpay_state_update ) {
+         delta_total_votepay_share = _gstate3->total_vpay_share_change_rate
+                                       * double( (ct - _gstate3->last_vpay_state_update).count() / 1E6 );
       }
 
       delta_total_votepay_share += additional_shares_delta;
-      if( delta_total_votepay_share < 0 && _gstate2.total_producer_votepay_share < -delta_total_votepay_share ) {
-         _gstate2.total_producer_votepay_share = 0.0;
+      if( delta_total_votepay_share < 0 && _gstate2->total_producer_votepay_share < -delta_total_votepay_share ) {
+         _gstate2->total_producer_votepay_share = 0.0;
       } else {
-         _gstate2.total_producer_votepay_share += delta_total_votepay_share;
+         _gstate2->total_producer_votepay_share += delta_total_votepay_share;
       }
 
-      if( shares_rate_delta < 0 && _gstate3.total_vpay_share_change_rate < -shares_rate_delta ) {
-         _gstate3.total_vpay_share_change_rate = 0.0;
+      if( shares_rate_delta < 0 && _gstate3->total_vpay_share_change_rate < -shares_rate_delta ) {
+         _gstate3->total_vpay_share_change_rate = 0.0;
       } else {
-         _gstate3.total_vpay_share_change_rate += shares_rate_delta;
+         _gstate3->total_vpay_share_change_rate += shares_rate_delta;
       }
 
-      _gstate3.last_vpay_state_update = ct;
+      _gstate3->last_vpay_state_update = ct;
 
-      return _gstate2.total_producer_votepay_share;
+      return _gstate2->total_producer_votepay_share;
    }
 
-   double system_contract::update_producer_votepay_share( const producers_table2::const_iterator& prod_itr,
-                                                          const time_point& ct,
-                                                          double shares_rate,
-                                                          bool reset_to_zero )
+   /**
+    * Settles `state` up to `ct` given the producer's `init_total_votes` prior to a change of `votes_delta`, and
+    * accumulates the resulting adjustments of the global votepay share state.
+    */
+   static void settle_votepay_share( producer_votepay_state& state, const time_point& last_claim_time,
+                                     double init_total_votes, double votes_delta, const time_point& ct,
+                                     double& delta_change_rate, double& total_inactive_vpay_share )
    {
-      double delta_votepay_share = 0.0;
-      if( shares_rate > 0.0 && ct > prod_itr->last_votepay_share_update ) {
-         delta_votepay_share = shares_rate * double( (ct - prod_itr->last_votepay_share_update).count() / 1E6 ); // cannot be negative
+      const auto last_claim_plus_3days = last_claim_time + microseconds(3 * useconds_per_day);
+      bool crossed_threshold       = (last_claim_plus_3days <= ct);
+      bool updated_after_threshold = (last_claim_plus_3days <= state.last_votepay_share_update);
+      // Note: updated_after_threshold implies cross_threshold
+
+      double new_votepay_share = state.accrued_votepay_share( ct, updated_after_threshold ? 0.0 : init_total_votes );
+
+      // only reset votepay_share once after threshold
+      state.votepay_share             = ( crossed_threshold && !updated_after_threshold ) ? 0.0 : new_votepay_share;
+      state.last_votepay_share_update = ct;
+
+      if( !crossed_threshold ) {
+         delta_change_rate += votes_delta;
+      } else if( !updated_after_threshold ) {
+         total_inactive_vpay_share += new_votepay_share;
+         delta_change_rate -= init_total_votes;
       }
+   }
+
+   void system_contract::update_producer_votes( const producers_table::const_iterator& prod_itr, double votes_delta, const time_point& ct,
+                                                double& delta_change_rate, double& total_inactive_vpay_share )
+   {
+      const double init_total_votes = prod_itr->total_votes;
+      _producers.modify( prod_itr, same_payer, [&]( auto& p ) {
+         p.total_votes += votes_delta;
+         if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
+            p.total_votes = 0;
+         }
+         _gstate->total_producer_vote_weight += votes_delta;
+         //check( p.total_votes >= 0, "something bad happened" );
+         if( p.votepay_state.has_value() ) {
+            settle_votepay_share( p.votepay_state.value(), p.last_claim_time, init_total_votes, votes_delta, ct,
+                                  delta_change_rate, total_inactive_vpay_share );
+         }
+      });
 
-      double new_votepay_share = prod_itr->votepay_share + delta_votepay_share;
-      _producers2.modify( prod_itr, same_payer, [&](auto& p) {
-         if( reset_to_zero )
-            p.votepay_share = 0.0;
-         else
-            p.votepay_share = new_votepay_share;
+      track_producer_votes( init_total_votes, prod_itr->total_votes );
 
-         p.last_votepay_share_update = ct;
-      } );
+      if( prod_itr->votepay_state.has_value() )
+         return;
 
-      return new_votepay_share;
+      auto prod2 = _producers2.find( prod_itr->owner.value );
+      if( prod2 != _producers2.end() ) {
+         _producers2.modify( prod2, same_payer, [&]( auto& p2 ) {
+            producer_votepay_state state{ p2.votepay_share, p2.last_votepay_share_update };
+            settle_votepay_share( state, prod_itr->last_claim_time, init_total_votes, votes_delta, ct,
+                                  delta_change_rate, total_inactive_vpay_share );
+            p2.votepay_share             = state.votepay_share;
+            p2.last_votepay_share_update = state.last_votepay_share_update;
+         });
+      }
    }
 
    void system_contract::voteproducer( const name& voter_name, const name& proxy, const std::vector<name>& producers ) {
@@ -289,10 +407,10 @@ namespace eosiosystem {
        * after the chain has been activated, we can use last_vote_weight to determine that this is
        * their first vote and should consider their stake activated.
        */
-      if( _gstate.thresh_activated_stake_time == time_point() && voter->last_vote_weight <= 0.0 ) {
-         _gstate.total_activated_stake += voter->staked;
-         if( _gstate.total_activated_stake >= min_activated_stake ) {
-            _gstate.thresh_activated_stake_time = current_time_point();
+      if( _gstate->thresh_activated_stake_time == time_point() && voter->last_vote_weight <= 0.0 ) {
+         _gstate->total_activated_stake += voter->staked;
+         if( _gstate->total_activated_stake >= min_activated_stake ) {
+            _gstate->thresh_activated_stake_time = current_time_point();
          }
       }
 
@@ -301,22 +419,13 @@ namespace eosiosystem {
          new_vote_weight += voter->proxied_vote_weight;
       }
 
-      std::map<name, std::pair<double, bool /*new*/> > producer_deltas;
-      if ( voter->last_vote_weight > 0 ) {
-         if( voter->proxy ) {
-            auto old_proxy = _voters.find( voter->proxy.value );
-            check( old_proxy != _voters.end(), "old proxy not found" ); //data corruption
-            _voters.modify( old_proxy, same_payer, [&]( auto& vp ) {
-                  vp.proxied_vote_weight -= voter->last_vote_weight;
-               });
-            propagate_weight_change( *old_proxy );
-         } else {
-            for( const auto& p : voter->producers ) {
-               auto& d = producer_deltas[p];
-               d.first -= voter->last_vote_weight;
-               d.second = false;
-            }
-         }
+      if ( voter->last_vote_weight > 0 && voter->proxy ) {
+         auto old_proxy = _voters.find( voter->proxy.value );
+         check( old_proxy != _voters.end(), "old proxy not found" ); //data corruption
+         _voters.modify( old_proxy, same_payer, [&]( auto& vp ) {
+               vp.proxied_vote_weight -= voter->last_vote_weight;
+            });
+         propagate_weight_change( *old_proxy );
       }
 
       if( proxy ) {
@@ -329,13 +438,34 @@ namespace eosiosystem {
                });
             propagate_weight_change( *new_proxy );
          }
-      } else {
-         if( new_vote_weight >= 0 ) {
-            for( const auto& p : producers ) {
-               auto& d = producer_deltas[p];
-               d.first += new_vote_weight;
-               d.second = true;
-            }
+      }
+
+      // Both the previous and the new producer sets are sorted, so the per-producer deltas are produced by a single
+      // merge pass (in name order). Producers in both sets whose vote weight is unchanged need no update at all.
+      struct producer_delta {
+         name   producer;
+         double delta     = 0.0;
+         bool   is_new    = false; // producer is in the new set
+         bool   unchanged = false; // producer is in both sets and the vote weight did not change
+      };
+
+      static const std::vector<name> no_producers;
+      const auto& old_producers = ( voter->last_vote_weight > 0 && !voter->proxy ) ? voter->producers : no_producers;
+      const auto& new_producers = ( !proxy && new_vote_weight >= 0 ) ? producers : no_producers;
+
+      std::vector<producer_delta> producer_deltas;
+      producer_deltas.reserve( old_producers.size() + new_producers.size() );
+      for( auto old_itr = old_producers.begin(), new_itr = new_producers.begin();
+           old_itr != old_producers.end() || new_itr != new_producers.end(); )
+      {
+         if( new_itr == new_producers.end() || ( old_itr != old_producers.end() && *old_itr < *new_itr ) ) {
+            producer_deltas.push_back( { *old_itr++, -voter->last_vote_weight, false, false } );
+         } else if( old_itr == old_producers.end() || *new_itr < *old_itr ) {
+            producer_deltas.push_back( { *new_itr++, new_vote_weight, true, false } );
+         } else {
+            producer_deltas.push_back( { *new_itr++, new_vote_weight - voter->last_vote_weight, true,
+                                         new_vote_weight == voter->last_vote_weight } );
+            ++old_itr;
          }
       }
 
@@ -343,43 +473,20 @@ namespace eosiosystem {
       double delta_change_rate         = 0.0;
       double total_inactive_vpay_share = 0.0;
       for( const auto& pd : producer_deltas ) {
-         auto pitr = _producers.find( pd.first.value );
+         if( pd.unchanged && !voting ) {
+            continue;
+         }
+         auto pitr = _producers.find( pd.producer.value );
          if( pitr != _producers.end() ) {
-            if( voting && !pitr->active() && pd.second.second /* from new set */ ) {
+            if( voting && !pitr->active() && pd.is_new ) {
                check( false, ( "producer " + pitr->owner.to_string() + " is not currently registered" ).data() );
             }
-            double init_total_votes = pitr->total_votes;
-            _producers.modify( pitr, same_payer, [&]( auto& p ) {
-               p.total_votes += pd.second.first;
-               if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
-                  p.total_votes = 0;
-               }
-               _gstate.total_producer_vote_weight += pd.second.first;
-               //check( p.total_votes >= 0, "something bad happened" );
-            });
-            auto prod2 = _producers2.find( pd.first.value );
-            if( prod2 != _producers2.end() ) {
-               const auto last_claim_plus_3days = pitr->last_claim_time + microseconds(3 * useconds_per_day);
-               bool crossed_threshold       = (last_claim_plus_3days <= ct);
-               bool updated_after_threshold = (last_claim_plus_3days <= prod2->last_votepay_share_update);
-               // Note: updated_after_threshold implies cross_threshold
-
-               double new_votepay_share = update_producer_votepay_share( prod2,
-                                             ct,
-                                             updated_after_threshold ? 0.0 : init_total_votes,
-                                             crossed_threshold && !updated_after_threshold // only reset votepay_share once after threshold
-                                          );
-
-               if( !crossed_threshold ) {
-                  delta_change_rate += pd.second.first;
-               } else if( !updated_after_threshold ) {
-                  total_inactive_vpay_share += new_votepay_share;
-                  delta_change_rate -= init_total_votes;
-               }
+            if( !pd.unchanged ) {
+               update_producer_votes( pitr, pd.delta, ct, delta_change_rate, total_inactive_vpay_share );
             }
          } else {
-            if( pd.second.second ) {
-               check( false, ( "producer " + pd.first.to_string() + " is not registered" ).data() );
+            if( pd.is_new ) {
+               check( false, ( "producer " + pd.producer.to_string() + " is not registered" ).data() );
             }
          }
       }
@@ -403,7 +510,7 @@ namespace eosiosystem {
          _voters.modify( pitr, same_payer, [&]( auto& p ) {
                p.is_proxy = isproxy;
             });
-         propagate_weight_change( *pitr );
+         propagate_weight_change( *pitr, true );
       } else {
          _voters.emplace( proxy, [&]( auto& p ) {
                p.owner  = proxy;
@@ -412,15 +519,33 @@ namespace eosiosystem {
       }
    }
 
-   void system_contract::propagate_weight_change( const voter_info& voter ) {
+   void system_contract::proxyupdate( const name& proxy ) {
+      auto pitr = _voters.find( proxy.value );
+      check( pitr != _voters.end() && pitr->is_proxy, "proxy not found" );
+      propagate_weight_change( *pitr, true );
+   }
+
+   void system_contract::propagate_weight_change( const voter_info& voter, bool flush ) {
       check( !voter.proxy || !voter.is_proxy, "account registered as a proxy is not allowed to use a proxy" );
       double new_weight = stake2vote( voter.staked );
       if ( voter.is_proxy ) {
          new_weight += voter.proxied_vote_weight;
       }
 
-      /// don't propagate small changes (1 ~= epsilon)
-      if ( fabs( new_weight - voter.last_vote_weight ) > 1 )  {
+      /**
+       * A proxy may have many delegators whose stake changes would otherwise each rewrite all of the proxy's
+       * producers. Instead the pending change is kept as the difference between the proxy's current weight and its
+       * last_vote_weight, and is only propagated once it exceeds a fraction of that weight. The full pending change is
+       * applied by update_votes (voteproducer, stake changes of the proxy), and here when `flush` is set (regproxy,
+       * proxyupdate).
+       */
+      if ( voter.is_proxy && !flush &&
+           fabs( new_weight - voter.last_vote_weight ) <= std::max( 1.0, voter.last_vote_weight * proxy_weight_propagation_threshold ) ) {
+         return;
+      }
+
+      /// don't propagate small changes (1 ~= epsilon), unless the pending change is flushed
+      if ( fabs( new_weight - voter.last_vote_weight ) > 1 || ( flush && new_weight != voter.last_vote_weight ) )  {
          if ( voter.proxy ) {
             auto& proxy = _voters.get( voter.proxy.value, "proxy not found" ); //data corruption
             _voters.modify( proxy, same_payer, [&]( auto& p ) {
@@ -434,32 +559,9 @@ namespace eosiosystem {
             double delta_change_rate         = 0;
             double total_inactive_vpay_share = 0;
             for ( auto acnt : voter.producers ) {
-               auto& prod = _producers.get( acnt.value, "producer not found" ); //data corruption
-               const double init_total_votes = prod.total_votes;
-               _producers.modify( prod, same_payer, [&]( auto& p ) {
-                  p.total_votes += delta;
-                  _gstate.total_producer_vote_weight += delta;
-               });
-               auto prod2 = _producers2.find( acnt.value );
-               if ( prod2 != _producers2.end() ) {
-                  const auto last_claim_plus_3days = prod.last_claim_time + microseconds(3 * useconds_per_day);
-                  bool crossed_threshold       = (last_claim_plus_3days <= ct);
-                  bool updated_after_threshold = (last_claim_plus_3days <= prod2->last_votepay_share_update);
-                  // Note: updated_after_threshold implies cross_threshold
-
-                  double new_votepay_share = update_producer_votepay_share( prod2,
-                                                ct,
-                                                updated_after_threshold ? 0.0 : init_total_votes,
-                                                crossed_threshold && !updated_after_threshold // only reset votepay_share once after threshold
-                                             );
-
-                  if( !crossed_threshold ) {
-                     delta_change_rate += delta;
-                  } else if( !updated_after_threshold ) {
-                     total_inactive_vpay_share += new_votepay_share;
-                     delta_change_rate -= init_total_votes;
-                  }
-               }
+               auto prod = _producers.find( acnt.value );
+               check( prod != _producers.end(), "producer not found" ); //data corruption
+               update_producer_votes( prod, delta, ct, delta_change_rate, total_inactive_vpay_share );
             }
 
             update_total_votepay_share( ct, -total_inactive_vpay_share, delta_change_rate );
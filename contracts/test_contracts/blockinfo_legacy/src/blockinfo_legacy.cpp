@@ -0,0 +1,53 @@
+#include <eosio/binary_extension.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/singleton.hpp>
+#include <eosio/time.hpp>
+#include <vector>
+
+/// Temporarily deployed to the system account by tests to recreate the blockinfo table of a chain upgraded from a
+/// version before 3.11.0: the records are rewritten as version 0 records keyed by block height and the `blkinfostate`
+/// singleton is removed. The tables mirror the layout of the ones in `eosio.system`.
+class [[eosio::contract]]
+blockinfo_legacy : public eosio::contract {
+public:
+   using contract::contract;
+
+   struct block_info_record {
+      uint8_t                           version = 0;
+      uint32_t                          block_height;
+      eosio::time_point                 block_timestamp;
+      eosio::binary_extension<uint32_t> slot;
+
+      uint64_t primary_key() const { return slot.has_value() ? slot.value() : block_height; }
+
+      EOSLIB_SERIALIZE(block_info_record, (version)(block_height)(block_timestamp)(slot))
+   };
+
+   typedef eosio::multi_index< "blockinfo"_n, block_info_record > block_info_table;
+
+   struct block_info_state {
+      uint8_t  version             = 0;
+      uint32_t rolling_window_size = 0;
+      uint32_t latest_block_height = 0;
+   };
+
+   typedef eosio::singleton< "blkinfostate"_n, block_info_state > block_info_state_singleton;
+
+   [[eosio::action]]
+   void tolegacy() {
+      std::vector<block_info_record> records;
+      block_info_table t{ get_self(), 0 };
+      for (auto itr = t.begin(); itr != t.end(); itr = t.erase(itr))
+         records.push_back(*itr);
+
+      for (const auto& r : records) {
+         t.emplace(get_self(), [&](auto& row) {
+            row.block_height    = r.block_height;
+            row.block_timestamp = r.block_timestamp;
+         });
+      }
+
+      block_info_state_singleton{ get_self(), 0 }.remove();
+   }
+};
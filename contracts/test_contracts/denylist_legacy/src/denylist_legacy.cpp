@@ -0,0 +1,43 @@
+#include <eosio/contract.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <vector>
+
+/// Temporarily deployed to the system account by tests to recreate the account name denylist of a chain upgraded from
+/// a version before 3.11.0: the patterns held in the size shards are moved to the single `acctdenylist` row.
+/// The tables mirror the layout of the ones in `eosio.system`.
+class [[eosio::contract]]
+denylist_legacy : public eosio::contract {
+public:
+   using contract::contract;
+
+   struct account_name_blacklist {
+      std::vector<eosio::name> disallowed;
+
+      uint64_t primary_key() const { return 0; }
+   };
+
+   typedef eosio::multi_index< "acctdenylist"_n, account_name_blacklist > account_name_blacklist_table;
+
+   struct denylist_pattern_group {
+      uint8_t                size;
+      std::vector<uint64_t>  values;
+
+      uint64_t primary_key() const { return size; }
+   };
+
+   typedef eosio::multi_index< "acctdenyshrd"_n, denylist_pattern_group > denylist_shard_table;
+
+   [[eosio::action]]
+   void tolegacy() {
+      std::vector<eosio::name> disallowed;
+      denylist_shard_table shards{ get_self(), get_self().value };
+      for (auto shard = shards.begin(); shard != shards.end(); shard = shards.erase(shard)) {
+         for (auto v : shard->values)
+            disallowed.push_back(eosio::name{ v << (64 - 5 * shard->size) });
+      }
+
+      account_name_blacklist_table bl_table{ get_self(), get_self().value };
+      bl_table.emplace(get_self(), [&](auto& bl) { bl.disallowed = std::move(disallowed); });
+   }
+};
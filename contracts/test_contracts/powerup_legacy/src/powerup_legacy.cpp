@@ -0,0 +1,69 @@
+#include <eosio/contract.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+/// Temporarily deployed to the system account by tests to recreate the powerup queue of a chain upgraded from a
+/// version before 3.11.0: the orders held in expiry buckets are moved to `powup.order` rows.
+/// The tables mirror the layout of the ones in `eosio.system`.
+class [[eosio::contract]]
+powerup_legacy : public eosio::contract {
+public:
+   using contract::contract;
+
+   struct powerup_order {
+      uint8_t              version = 0;
+      uint64_t             id;
+      eosio::name          owner;
+      int64_t              net_weight;
+      int64_t              cpu_weight;
+      eosio::time_point_sec expires;
+
+      uint64_t primary_key()const { return id; }
+      uint64_t by_owner()const    { return owner.value; }
+      uint64_t by_expires()const  { return expires.utc_seconds; }
+   };
+
+   typedef eosio::multi_index< "powup.order"_n, powerup_order,
+                               eosio::indexed_by<"byowner"_n, eosio::const_mem_fun<powerup_order, uint64_t, &powerup_order::by_owner>>,
+                               eosio::indexed_by<"byexpires"_n, eosio::const_mem_fun<powerup_order, uint64_t, &powerup_order::by_expires>>
+                               > powerup_order_table;
+
+   struct powerup_expiry_bucket {
+      uint8_t              version = 0;
+      eosio::time_point_sec expires;
+
+      uint64_t primary_key()const { return expires.utc_seconds; }
+   };
+
+   typedef eosio::multi_index< "powup.bucket"_n, powerup_expiry_bucket > powerup_bucket_table;
+
+   struct powerup_bucket_entry {
+      uint8_t              version = 0;
+      eosio::name          owner;
+      int64_t              net_weight;
+      int64_t              cpu_weight;
+
+      uint64_t primary_key()const { return owner.value; }
+   };
+
+   typedef eosio::multi_index< "powup.entry"_n, powerup_bucket_entry > powerup_entry_table;
+
+   [[eosio::action]]
+   void tolegacy() {
+      powerup_order_table  orders{ get_self(), 0 };
+      powerup_bucket_table buckets{ get_self(), 0 };
+      for (auto bucket = buckets.begin(); bucket != buckets.end(); bucket = buckets.erase(bucket)) {
+         powerup_entry_table entries{ get_self(), bucket->expires.utc_seconds };
+         for (auto it = entries.begin(); it != entries.end(); it = entries.erase(it)) {
+            orders.emplace(get_self(), [&](auto& order) {
+               order.id         = orders.available_primary_key();
+               order.owner      = it->owner;
+               order.net_weight = it->net_weight;
+               order.cpu_weight = it->cpu_weight;
+               order.expires    = bucket->expires;
+            });
+         }
+      }
+   }
+};
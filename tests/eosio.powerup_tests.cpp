@@ -7,9 +7,11 @@
 #include <eosio/chain/wast_to_wasm.hpp>
 #include <fc/log/logger.hpp>
 #include <iostream>
+#include <random>
 #include <sstream>
 
 #include "eosio.system_tester.hpp"
+#include "../contracts/eosio.system/include/eosio.system/powerup_curve.hpp"
 
 inline constexpr int64_t powerup_frac  = 1'000'000'000'000'000ll; // 1.0 = 10^15
 inline constexpr int64_t stake_weight = 100'000'000'0000ll; // 10^12
@@ -67,6 +69,39 @@ struct powerup_state {
 };
 FC_REFLECT(powerup_state, (version)(net)(cpu)(powerup_days)(min_powerup_fee))
 
+struct powerup_order {
+   uint8_t        version;
+   uint64_t       id;
+   name           owner;
+   int64_t        net_weight;
+   int64_t        cpu_weight;
+   time_point_sec expires;
+};
+FC_REFLECT(powerup_order, (version)(id)(owner)(net_weight)(cpu_weight)(expires))
+
+struct powerup_expiry_bucket {
+   uint8_t        version;
+   time_point_sec expires;
+};
+FC_REFLECT(powerup_expiry_bucket, (version)(expires))
+
+struct powerup_bucket_entry {
+   uint8_t version;
+   name    owner;
+   int64_t net_weight;
+   int64_t cpu_weight;
+};
+FC_REFLECT(powerup_bucket_entry, (version)(owner)(net_weight)(cpu_weight))
+
+struct powerup_quote {
+   asset   fee;
+   int64_t net_amount;
+   int64_t cpu_amount;
+   int64_t net_utilization;
+   int64_t cpu_utilization;
+};
+FC_REFLECT(powerup_quote, (fee)(net_amount)(cpu_amount)(net_utilization)(cpu_utilization))
+
 using namespace eosio_system;
 
 struct powerup_tester : eosio_system_tester {
@@ -176,11 +211,62 @@ struct powerup_tester : eosio_system_tester {
                                "cpu_frac", cpu_frac)("max_payment", max_payment));
    }
 
+   powerup_quote powerupquote(int64_t net_frac, int64_t cpu_frac) {
+      signed_transaction trx;
+      trx.actions.emplace_back(get_action(config::system_account_name, "powerupquote"_n, vector<permission_level>{},
+                                          mvo()("net_frac", net_frac)("cpu_frac", cpu_frac)));
+      set_transaction_headers(trx);
+
+      transaction_trace_ptr trace = push_transaction(trx, fc::time_point::maximum(), DEFAULT_BILLED_CPU_TIME_US,
+                                                     false, transaction_metadata::trx_type::read_only);
+      const auto& retval = trace->action_traces[0].return_value;
+      return fc::raw::unpack<powerup_quote>(retval);
+   }
+
    powerup_state get_state() {
       vector<char> data = get_row_by_account(config::system_account_name, {}, "powup.state"_n, "powup.state"_n);
       return fc::raw::unpack<powerup_state>(data);
    }
 
+   template <typename T>
+   vector<T> get_table_rows(name scope, name table) {
+      const auto& db = control->db();
+      namespace chain = eosio::chain;
+      const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>(
+            boost::make_tuple(config::system_account_name, scope, table));
+      vector<T> rows;
+      if (!t_id)
+         return rows;
+
+      const auto& idx = db.get_index<chain::key_value_index, chain::by_scope_primary>();
+      for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id, 0)); itr != idx.end() && itr->t_id == t_id->id; ++itr) {
+         vector<char> data(itr->value.data(), itr->value.data() + itr->value.size());
+         rows.push_back(fc::raw::unpack<T>(data));
+      }
+      return rows;
+   }
+
+   vector<powerup_expiry_bucket> get_expiry_buckets() {
+      return get_table_rows<powerup_expiry_bucket>(name{}, "powup.bucket"_n);
+   }
+
+   vector<powerup_bucket_entry> get_bucket_entries(time_point_sec expires) {
+      return get_table_rows<powerup_bucket_entry>(name{ expires.sec_since_epoch() }, "powup.entry"_n);
+   }
+
+   // Produces blocks until the pending block starts an hour, so that an order placed in it expires exactly
+   // `powerup_days` later instead of at the end of its expiry bucket
+   void align_to_expiry_bucket() {
+      const int64_t next_block = (control->head().block_time() + fc::milliseconds(500)).time_since_epoch().count();
+      const int64_t into_hour  = next_block % fc::hours(1).count();
+      if (into_hour)
+         produce_block(fc::microseconds(fc::hours(1).count() - into_hour));
+   }
+
+   int64_t get_ram_usage(name account) {
+      return control->get_resource_limits_manager().get_account_ram_usage(account);
+   }
+
    struct account_info {
       int64_t ram = 0;
       int64_t net = 0;
@@ -295,6 +381,8 @@ BOOST_FIXTURE_TEST_CASE(config_tests, powerup_tester) try {
                        })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("exponent must be >= 1"),
                        configbw(make_config([&](auto& c) { c.net.exponent = .999; })));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("exponent is too large"),
+                       configbw(make_config([&](auto& c) { c.net.exponent = 5e9; })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("decay_secs must be >= 1"),
                        configbw(make_config([&](auto& c) { c.net.decay_secs = 0; })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("max_price does not have a default value"),
@@ -340,6 +428,8 @@ BOOST_FIXTURE_TEST_CASE(config_tests, powerup_tester) try {
                        })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("exponent must be >= 1"),
                        configbw(make_config([&](auto& c) { c.cpu.exponent = .999; })));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("exponent is too large"),
+                       configbw(make_config([&](auto& c) { c.cpu.exponent = 5e9; })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("decay_secs must be >= 1"),
                        configbw(make_config([&](auto& c) { c.cpu.decay_secs = 0; })));
    BOOST_REQUIRE_EQUAL(wasm_assert_msg("max_price does not have a default value"),
@@ -557,6 +647,7 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       // (.2) * 1000000.0000 = 200000.0000
       //               total = 300000.0000
       t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("300000.0000"));
+      t.align_to_expiry_bucket();
       t.check_powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac * .1, powerup_frac * .2,
                      core_sym::from_string("300000.0000"), net_weight * .1, cpu_weight * .2);
 
@@ -578,9 +669,9 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       // (0.0135 + 0.02 - 0.0135) * 1000000.0000 = 20000.0000
       // (.02) * 1000000.0000                    = 20000.0000
       //                                   total = 40000.0000
-      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("40000.0001"));
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("40000.0000"));
       t.check_powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac * .02, powerup_frac * .02,
-                     core_sym::from_string("40000.0001"), net_weight * .02, cpu_weight * .02);
+                     core_sym::from_string("40000.0000"), net_weight * .02, cpu_weight * .02);
    }
 
    auto init = [](auto& t, bool rex) {
@@ -692,9 +783,9 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       // (.3 ^ 2) * 2000000.0000 / 2 =  90000.0000
       // (.4 ^ 3) * 6000000.0000 / 3 = 128000.0000
       //                       total = 218000.0000
-      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("218000.0001"));
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("218000.0000"));
       t.check_powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .3, powerup_frac * .4,
-                     core_sym::from_string("218000.0001"), net_weight * .3, cpu_weight * .4);
+                     core_sym::from_string("218000.0000"), net_weight * .3, cpu_weight * .4);
 
       // (.35 ^ 2) * 2000000.0000 / 2 -  90000.0000 =  32500.0000
       // (.5  ^ 3) * 6000000.0000 / 3 - 128000.0000 = 122000.0000
@@ -745,6 +836,7 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       powerup_tester t;
       init(t, true);
       t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("3000000.0000"));
+      t.align_to_expiry_bucket();
       t.check_powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac, powerup_frac,
                      core_sym::from_string("3000000.0000"), net_weight, cpu_weight);
 
@@ -825,9 +917,10 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       // (.1 ^ 2) * 2000000.0000 / 2 = 10000.0000
       // (.2 ^ 3) * 6000000.0000 / 3 = 16000.0000
       //                       total = 26000.0000
-      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("26000.0002"));
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("26000.0000"));
+      t.align_to_expiry_bucket();
       t.check_powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .1, powerup_frac * .2,
-                     core_sym::from_string("26000.0002"), net_weight * .1, cpu_weight * .2);
+                     core_sym::from_string("26000.0000"), net_weight * .1, cpu_weight * .2);
 
       t.produce_block(fc::days(15) - fc::milliseconds(500));
 
@@ -835,9 +928,9 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
       // (.3 ^ 2) * 2000000.0000 / 2 - 10000.0000 =  80000.0000
       // (.4 ^ 3) * 6000000.0000 / 3 - 16000.0000 = 112000.0000
       //                                    total = 192000.0000
-      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("192000.0001"));
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("192000.0000"));
       t.check_powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .2, powerup_frac * .2,
-                     core_sym::from_string("192000.0001"), net_weight * .2, cpu_weight * .2);
+                     core_sym::from_string("192000.0000"), net_weight * .2, cpu_weight * .2);
 
       // Start decay
       t.produce_block(fc::days(15) - fc::milliseconds(1000));
@@ -862,7 +955,292 @@ BOOST_AUTO_TEST_CASE(rent_tests) try {
             near(t.get_state().cpu.adjusted_utilization, int64_t(.2 * cpu_weight * exp(-2) + .2 * cpu_weight), 0));
    }
 
+   // several orders of the same receivers expire in the same sweep
+   {
+      powerup_tester t;
+      init(t, true);
+      auto before_a = t.get_account_info("aaaaaaaaaaaa"_n);
+      auto before_b = t.get_account_info("bbbbbbbbbbbb"_n);
+
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("5000.0000"));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .01, powerup_frac * .01,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .01, powerup_frac * .02,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac * .02, powerup_frac * .01,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE(before_b.net < t.get_account_info("bbbbbbbbbbbb"_n).net);
+      BOOST_REQUIRE(before_b.cpu < t.get_account_info("bbbbbbbbbbbb"_n).cpu);
+      BOOST_REQUIRE(before_a.net < t.get_account_info("aaaaaaaaaaaa"_n).net);
+
+      t.produce_block(fc::days(30) + fc::hours(1));
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 10));
+      BOOST_REQUIRE_EQUAL(before_a.net, t.get_account_info("aaaaaaaaaaaa"_n).net);
+      BOOST_REQUIRE_EQUAL(before_a.cpu, t.get_account_info("aaaaaaaaaaaa"_n).cpu);
+      BOOST_REQUIRE_EQUAL(before_b.net, t.get_account_info("bbbbbbbbbbbb"_n).net);
+      BOOST_REQUIRE_EQUAL(before_b.cpu, t.get_account_info("bbbbbbbbbbbb"_n).cpu);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().cpu.utilization);
+      BOOST_REQUIRE(t.get_expiry_buckets().empty());
+   }
+
+   // orders of the same receiver placed within the same hour are coalesced
+   {
+      powerup_tester t;
+      init(t, true);
+      auto before_b = t.get_account_info("bbbbbbbbbbbb"_n);
+
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("5000.0000"));
+      t.align_to_expiry_bucket();
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("1000.0000")));
+      t.produce_block(fc::minutes(20));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("1000.0000")));
+      t.produce_block(fc::minutes(30));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 50, powerup_frac / 50,
+                                        core_sym::from_string("2000.0000")));
+      auto buckets = t.get_expiry_buckets();
+      BOOST_REQUIRE_EQUAL(1, buckets.size());
+      auto entries = t.get_bucket_entries(buckets[0].expires);
+      BOOST_REQUIRE_EQUAL(2, entries.size());
+      BOOST_REQUIRE_EQUAL("aaaaaaaaaaaa"_n, entries[0].owner);
+      BOOST_REQUIRE_EQUAL("bbbbbbbbbbbb"_n, entries[1].owner);
+      BOOST_REQUIRE_EQUAL(net_weight * 3 / 100, entries[1].net_weight);
+      BOOST_REQUIRE_EQUAL(cpu_weight * 3 / 100, entries[1].cpu_weight);
+      BOOST_REQUIRE_EQUAL(before_b.net + net_weight * 3 / 100, t.get_account_info("bbbbbbbbbbbb"_n).net);
+
+      // the next hour starts a new bucket
+      t.produce_block(fc::minutes(10));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("2000.0000")));
+      BOOST_REQUIRE_EQUAL(2, t.get_expiry_buckets().size());
+      BOOST_REQUIRE_EQUAL(1, t.get_bucket_entries(t.get_expiry_buckets()[1].expires).size());
+
+      t.produce_block(fc::days(30) + fc::hours(1));
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 3));
+      BOOST_REQUIRE(t.get_expiry_buckets().empty());
+      BOOST_REQUIRE_EQUAL(before_b.net, t.get_account_info("bbbbbbbbbbbb"_n).net);
+      BOOST_REQUIRE_EQUAL(before_b.cpu, t.get_account_info("bbbbbbbbbbbb"_n).cpu);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().cpu.utilization);
+   }
+
+   // powerupquote matches the powerup which follows it, including the expiry of pending orders
+   {
+      powerup_tester t;
+      init(t, true);
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("10000.0000"));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 10, powerup_frac / 10,
+                                        core_sym::from_string("5000.0000")));
+
+      auto quote = t.powerupquote(powerup_frac / 50, powerup_frac / 100);
+      BOOST_REQUIRE_EQUAL(net_weight / 50, quote.net_amount);
+      BOOST_REQUIRE_EQUAL(cpu_weight / 100, quote.cpu_amount);
+      BOOST_REQUIRE_EQUAL(net_weight / 10 + net_weight / 50, quote.net_utilization);
+      BOOST_REQUIRE_EQUAL(cpu_weight / 10 + cpu_weight / 100, quote.cpu_utilization);
+      t.check_powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac / 50, powerup_frac / 100, quote.fee,
+                      quote.net_amount, quote.cpu_amount);
+
+      t.produce_block(fc::days(30) + fc::hours(1));
+      quote = t.powerupquote(powerup_frac / 50, powerup_frac / 100);
+      BOOST_REQUIRE_EQUAL(net_weight / 50, quote.net_utilization);
+      BOOST_REQUIRE_EQUAL(cpu_weight / 100, quote.cpu_utilization);
+      BOOST_REQUIRE(!t.get_expiry_buckets().empty());
+      auto before = t.get_account_info("aaaaaaaaaaaa"_n);
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 50, powerup_frac / 100,
+                                        quote.fee));
+      BOOST_REQUIRE_EQUAL(before.liquid - t.get_account_info("aaaaaaaaaaaa"_n).liquid, quote.fee);
+      BOOST_REQUIRE_EQUAL(quote.net_utilization, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(quote.cpu_utilization, t.get_state().cpu.utilization);
+
+      BOOST_REQUIRE_EXCEPTION(t.powerupquote(-1, 0), eosio_assert_message_exception,
+                              eosio_assert_message_is("net_frac can't be negative"));
+
+      // a fee that powerup would reject is not quoted
+      BOOST_REQUIRE_EXCEPTION(t.powerupquote(10, 10), eosio_assert_message_exception,
+                              eosio_assert_message_is("calculated fee is below minimum; try powering up with more resources"));
+   }
+
+   // buckets and entries are billed to the payers which create them, and expired entries are retired a bounded
+   // number at a time
+   {
+      powerup_tester t;
+      init(t, true);
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("5000.0000"));
+      t.transfer(config::system_account_name, "bbbbbbbbbbbb"_n, core_sym::from_string("5000.0000"));
+      t.align_to_expiry_bucket();
+      auto system_ram = t.get_ram_usage(config::system_account_name);
+      auto a_ram      = t.get_ram_usage("aaaaaaaaaaaa"_n);
+      auto b_ram      = t.get_ram_usage("bbbbbbbbbbbb"_n);
+
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("1000.0000")));
+      auto a_ram_with_bucket = t.get_ram_usage("aaaaaaaaaaaa"_n);
+      BOOST_REQUIRE(a_ram < a_ram_with_bucket);
+      BOOST_REQUIRE_EQUAL(b_ram, t.get_ram_usage("bbbbbbbbbbbb"_n));
+
+      // the bucket exists, so only an entry is added
+      BOOST_REQUIRE_EQUAL("", t.powerup("bbbbbbbbbbbb"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("1000.0000")));
+      auto b_ram_with_entry = t.get_ram_usage("bbbbbbbbbbbb"_n);
+      BOOST_REQUIRE(b_ram < b_ram_with_entry);
+      BOOST_REQUIRE(b_ram_with_entry - b_ram < a_ram_with_bucket - a_ram);
+
+      // adding to an existing entry doesn't use more RAM
+      BOOST_REQUIRE_EQUAL("", t.powerup("bbbbbbbbbbbb"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac / 100, powerup_frac / 100,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE_EQUAL(a_ram_with_bucket, t.get_ram_usage("aaaaaaaaaaaa"_n));
+      BOOST_REQUIRE_EQUAL(b_ram_with_entry, t.get_ram_usage("bbbbbbbbbbbb"_n));
+      BOOST_REQUIRE_EQUAL(system_ram, t.get_ram_usage(config::system_account_name));
+
+      auto buckets = t.get_expiry_buckets();
+      BOOST_REQUIRE_EQUAL(1, buckets.size());
+      BOOST_REQUIRE_EQUAL(2, t.get_bucket_entries(buckets[0].expires).size());
+
+      t.produce_block(fc::days(30) + fc::hours(1));
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 1));
+      BOOST_REQUIRE_EQUAL(1, t.get_expiry_buckets().size());
+      BOOST_REQUIRE_EQUAL(1, t.get_bucket_entries(buckets[0].expires).size());
+      BOOST_REQUIRE_EQUAL(b_ram, t.get_ram_usage("bbbbbbbbbbbb"_n));
+
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 1));
+      BOOST_REQUIRE(t.get_expiry_buckets().empty());
+      BOOST_REQUIRE(t.get_bucket_entries(buckets[0].expires).empty());
+      BOOST_REQUIRE(t.get_ram_usage("aaaaaaaaaaaa"_n) < a_ram_with_bucket);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().cpu.utilization);
+   }
+
+   // orders placed before version 3.11.0 are retired before the ones in buckets
+   {
+      powerup_tester t;
+      init(t, true);
+      auto before_a = t.get_account_info("aaaaaaaaaaaa"_n);
+      auto before_b = t.get_account_info("bbbbbbbbbbbb"_n);
+
+      t.transfer(config::system_account_name, "aaaaaaaaaaaa"_n, core_sym::from_string("5000.0000"));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .01, powerup_frac * .01,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "aaaaaaaaaaaa"_n, 30, powerup_frac * .02, powerup_frac * .01,
+                                        core_sym::from_string("1000.0000")));
+
+      // move the orders to `powup.order`, as a chain upgraded from an earlier version has them
+      t.set_code(config::system_account_name, system_contracts::testing::test_contracts::powerup_legacy_wasm());
+      t.set_abi(config::system_account_name, system_contracts::testing::test_contracts::powerup_legacy_abi().data());
+      t.base_tester::push_action(config::system_account_name, "tolegacy"_n, config::system_account_name, mvo());
+      t.set_code(config::system_account_name, contracts::system_wasm());
+      t.set_abi(config::system_account_name, contracts::system_abi().data());
+      BOOST_REQUIRE(t.get_expiry_buckets().empty());
+      BOOST_REQUIRE_EQUAL(2, t.get_table_rows<powerup_order>(name{}, "powup.order"_n).size());
+
+      BOOST_REQUIRE_EQUAL("", t.powerup("aaaaaaaaaaaa"_n, "bbbbbbbbbbbb"_n, 30, powerup_frac * .01, powerup_frac * .02,
+                                        core_sym::from_string("1000.0000")));
+      BOOST_REQUIRE_EQUAL(1, t.get_expiry_buckets().size());
+
+      t.produce_block(fc::days(30) + fc::hours(1));
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 2));
+      BOOST_REQUIRE(t.get_table_rows<powerup_order>(name{}, "powup.order"_n).empty());
+      BOOST_REQUIRE_EQUAL(1, t.get_expiry_buckets().size());
+      BOOST_REQUIRE_EQUAL(before_a.net, t.get_account_info("aaaaaaaaaaaa"_n).net);
+      BOOST_REQUIRE_EQUAL(before_a.cpu, t.get_account_info("aaaaaaaaaaaa"_n).cpu);
+      BOOST_REQUIRE_EQUAL(net_weight / 100, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(cpu_weight / 50, t.get_state().cpu.utilization);
+
+      BOOST_REQUIRE_EQUAL("", t.powerupexec(config::system_account_name, 2));
+      BOOST_REQUIRE(t.get_expiry_buckets().empty());
+      BOOST_REQUIRE_EQUAL(before_b.net, t.get_account_info("bbbbbbbbbbbb"_n).net);
+      BOOST_REQUIRE_EQUAL(before_b.cpu, t.get_account_info("bbbbbbbbbbbb"_n).cpu);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().net.utilization);
+      BOOST_REQUIRE_EQUAL(0, t.get_state().cpu.utilization);
+   }
+
 } // rent_tests
 FC_LOG_AND_RETHROW()
 
+// Fee as computed with doubles before the fixed-point price curve
+int64_t calc_powerup_fee_double(const powerup_state_resource& state, int64_t utilization_increase) {
+   if (utilization_increase <= 0)
+      return 0;
+
+   auto price_integral_delta = [&state](int64_t start_utilization, int64_t end_utilization) -> double {
+      double coefficient = (state.max_price.get_amount() - state.min_price.get_amount()) / state.exponent;
+      double start_u     = double(start_utilization) / state.weight;
+      double end_u       = double(end_utilization) / state.weight;
+      return state.min_price.get_amount() * end_u - state.min_price.get_amount() * start_u +
+             coefficient * std::pow(end_u, state.exponent) - coefficient * std::pow(start_u, state.exponent);
+   };
+
+   auto price_function = [&state](int64_t utilization) -> double {
+      double new_exponent = state.exponent - 1.0;
+      if (new_exponent <= 0.0)
+         return state.max_price.get_amount();
+      return state.min_price.get_amount() + (state.max_price.get_amount() - state.min_price.get_amount()) *
+                                                  std::pow(double(utilization) / state.weight, new_exponent);
+   };
+
+   double  fee               = 0.0;
+   int64_t start_utilization = state.utilization;
+   int64_t end_utilization   = start_utilization + utilization_increase;
+
+   if (start_utilization < state.adjusted_utilization) {
+      fee += price_function(state.adjusted_utilization) *
+             std::min(utilization_increase, state.adjusted_utilization - start_utilization) / state.weight;
+      start_utilization = state.adjusted_utilization;
+   }
+
+   if (start_utilization < end_utilization) {
+      fee += price_integral_delta(start_utilization, end_utilization);
+   }
+
+   return std::ceil(fee);
+}
+
+int64_t calc_powerup_fee_fixed(const powerup_state_resource& state, int64_t utilization_increase) {
+   uint32_t exponent_integer  = uint32_t(state.exponent);
+   uint64_t exponent_fraction = uint64_t((state.exponent - exponent_integer) * double(uint64_t(1) << 60));
+   return eosiosystem::powerup_curve::fee(state.min_price.get_amount(), state.max_price.get_amount(), exponent_integer,
+                                          exponent_fraction, state.weight, state.utilization,
+                                          state.adjusted_utilization, utilization_increase);
+}
+
+BOOST_AUTO_TEST_CASE(price_curve_tests) try {
+   std::mt19937_64 rng(20240611);
+   auto            random = [&](int64_t max) { return int64_t(rng() % uint64_t(max + 1)); };
+   const double    exponents[] = { 1.0, 1.5, 2.0, 2.7, 3.0, 7.25 };
+
+   for (int i = 0; i < 100000; ++i) {
+      powerup_state_resource state{};
+      state.weight               = 1 + random(i % 2 ? 1'000'000'000'000'000ll : 1'000'000);
+      state.exponent             = exponents[i % std::size(exponents)];
+      state.max_price            = asset(1 + random(100'000'000'000ll), symbol{CORE_SYM});
+      state.min_price            = state.exponent == 1.0 ? state.max_price
+                                                         : asset(random(state.max_price.get_amount()), symbol{CORE_SYM});
+      state.utilization          = random(state.weight);
+      state.adjusted_utilization = state.utilization + random(state.weight - state.utilization);
+      int64_t increase           = random(state.weight - state.utilization);
+
+      int64_t expected = calc_powerup_fee_double(state, increase);
+      int64_t fee      = calc_powerup_fee_fixed(state, increase);
+      if (std::abs(fee - expected) > 1) {
+         elog("fee ${f} differs from ${e}: exponent ${x}, weight ${w}, utilization ${u}, adjusted ${a}, increase ${i}",
+              ("f", fee)("e", expected)("x", state.exponent)("w", state.weight)("u", state.utilization)(
+                    "a", state.adjusted_utilization)("i", increase));
+         BOOST_REQUIRE(false);
+      }
+   }
+
+   // fees of exact values are exact, while the double evaluation may round them up
+   powerup_state_resource net{};
+   net.weight    = stake_weight * 3;
+   net.exponent  = 2;
+   net.min_price = core_sym::from_string("0.0000");
+   net.max_price = core_sym::from_string("2000000.0000");
+   BOOST_REQUIRE_EQUAL(100000001, calc_powerup_fee_double(net, net.weight / 10));
+   BOOST_REQUIRE_EQUAL(100000000, calc_powerup_fee_fixed(net, net.weight / 10));
+   net.utilization = net.adjusted_utilization = net.weight * 3 / 10;
+   BOOST_REQUIRE_EQUAL(325000000, calc_powerup_fee_fixed(net, net.weight / 20));
+}
+FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
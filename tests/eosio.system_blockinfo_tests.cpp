@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <functional>
 #include <limits>
 
@@ -21,22 +22,31 @@ namespace {
 
 struct block_info_record
 {
-   uint8_t        version = 0;
+   uint8_t        version = 1;
    uint32_t       block_height;
    fc::time_point block_timestamp;
+   uint32_t       slot = 0;
 
    friend bool operator==(const block_info_record& lhs, const block_info_record& rhs)
    {
-      return std::tie(lhs.version, lhs.block_height, lhs.block_timestamp) ==
-             std::tie(rhs.version, rhs.block_height, rhs.block_timestamp);
+      return std::tie(lhs.version, lhs.block_height, lhs.block_timestamp, lhs.slot) ==
+             std::tie(rhs.version, rhs.block_height, rhs.block_timestamp, rhs.slot);
    }
 };
 
+struct block_info_state
+{
+   uint8_t  version;
+   uint32_t rolling_window_size;
+   uint32_t latest_block_height;
+};
+
 static constexpr uint32_t rolling_window_size = 10;
 
 } // namespace
 
-FC_REFLECT(block_info_record, (version)(block_height)(block_timestamp))
+FC_REFLECT(block_info_record, (version)(block_height)(block_timestamp)(slot))
+FC_REFLECT(block_info_state, (version)(rolling_window_size)(latest_block_height))
 
 namespace {
 
@@ -46,6 +56,7 @@ using namespace system_contracts::testing;
 namespace blockinfo_tester = test_contracts::blockinfo_tester;
 
 static const eosio::chain::name blockinfo_table_name = "blockinfo"_n;
+static const eosio::chain::name blockinfo_state_name = "blkinfostate"_n;
 
 // cspell:disable-next-line
 static const eosio::chain::name blockinfo_tester_account_name = "binfotester"_n;
@@ -93,15 +104,25 @@ public:
 
       const auto& idx = control->db().get_index<eosio::chain::key_value_index, eosio::chain::by_scope_primary>();
 
-      unsigned int rows_visited = 0;
-
-      block_info_record r;
+      // Rows are keyed by their slot in the ring buffer, so collect and sort them by block height first.
+      std::vector<block_info_record> rows;
 
-      for (auto itr = idx.lower_bound(boost::make_tuple(*t_id, static_cast<uint64_t>(start_block_height)));
-           itr != idx.end() && itr->t_id == *t_id && itr->primary_key <= end_block_height; ++itr) //
-      {
+      for (auto itr = idx.lower_bound(boost::make_tuple(*t_id, 0)); itr != idx.end() && itr->t_id == *t_id; ++itr) {
+         block_info_record           r;
          fc::datastream<const char*> ds(itr->value.data(), itr->value.size());
          fc::raw::unpack(ds, r);
+         if (start_block_height <= r.block_height && r.block_height <= end_block_height) {
+            rows.push_back(std::move(r));
+         }
+      }
+
+      std::sort(rows.begin(), rows.end(), [](const block_info_record& lhs, const block_info_record& rhs) {
+         return lhs.block_height < rhs.block_height;
+      });
+
+      unsigned int rows_visited = 0;
+
+      for (auto& r : rows) {
          ++rows_visited;
          if (!visitor(std::move(r))) {
             break;
@@ -123,6 +144,16 @@ public:
       return result;
    }
 
+   std::optional<block_info_state> get_blockinfo_state()
+   {
+      vector<char> data = get_row_by_id(config::system_account_name, eosio::chain::name{0}, blockinfo_state_name,
+                                        blockinfo_state_name.to_uint64_t());
+      if (data.empty()) {
+         return {};
+      }
+      return fc::raw::unpack<block_info_state>(data);
+   }
+
    std::pair<std::optional<blockinfo_tester::latest_block_batch_info_result>, eosio::chain::transaction_trace_ptr>
    get_latest_block_batch_info(blockinfo_tester::get_latest_block_batch_info request)
    {
@@ -266,6 +297,7 @@ try {
       expected_table.push_back(block_info_record{
          .block_height    = block_height,
          .block_timestamp = block_timestamp,
+         .slot            = block_height % rolling_window_size,
       });
    };
 
@@ -550,4 +582,93 @@ try {
 }
 FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(blockinfo_window_size_tests, block_info_tester)
+try {
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("rolling_window_size must be between 1 and 172800"),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 0)));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("rolling_window_size must be between 1 and 172800"),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 172801)));
+
+   // The table holds the latest rolling_window_size blocks, each in slot block_height % rolling_window_size.
+   auto check_window = [this](uint32_t window_size) {
+      auto table = get_blockinfo_table();
+      BOOST_REQUIRE_EQUAL(window_size, table.size());
+      BOOST_REQUIRE(control->head().block_num() <= table.back().block_height);
+      for (size_t i = 0; i < table.size(); ++i) {
+         BOOST_REQUIRE_EQUAL(table.front().block_height + i, table[i].block_height);
+         BOOST_REQUIRE_EQUAL(table[i].block_height % window_size, table[i].slot);
+         BOOST_REQUIRE_EQUAL(1, table[i].version);
+      }
+   };
+
+   produce_blocks(rolling_window_size + 5);
+   check_window(rolling_window_size);
+
+   // Growing the window keeps more blocks.
+   BOOST_REQUIRE_EQUAL(success(), push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 25)));
+   produce_blocks(30);
+   check_window(25);
+
+   // Shrinking the window erases the records that no longer fit, up to two per block.
+   BOOST_REQUIRE_EQUAL(success(), push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 5)));
+   produce_blocks(15);
+   check_window(5);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(blockinfo_state_tests, block_info_tester)
+try {
+   // The blkinfostate singleton records the latest block, whose record is in the slot computed from its height.
+   auto check_latest_block = [this](uint32_t window_size, uint32_t num_blocks) {
+      for (uint32_t i = 0; i < num_blocks; ++i) {
+         produce_blocks(1);
+         auto state = get_blockinfo_state();
+         auto table = get_blockinfo_table();
+         BOOST_REQUIRE(state.has_value());
+         BOOST_REQUIRE_EQUAL(window_size, state->rolling_window_size);
+         BOOST_REQUIRE_EQUAL(table.back().block_height, state->latest_block_height);
+         BOOST_REQUIRE_EQUAL(state->latest_block_height % window_size, table.back().slot);
+      }
+   };
+
+   produce_blocks(rolling_window_size);
+   check_latest_block(rolling_window_size, 2 * rolling_window_size);
+
+   BOOST_REQUIRE_EQUAL(success(), push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 5)));
+   produce_blocks(1);
+   check_latest_block(5, 2 * 5);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(blockinfo_legacy_migration_tests, block_info_tester)
+try {
+   produce_blocks(rolling_window_size);
+   auto table = get_blockinfo_table();
+   BOOST_REQUIRE_EQUAL(rolling_window_size, table.size());
+
+   // Recreate the blockinfo table of a chain upgraded from a version before 3.11.0.
+   set_code(config::system_account_name, test_contracts::blockinfo_legacy_wasm());
+   set_abi(config::system_account_name, test_contracts::blockinfo_legacy_abi().data());
+   base_tester::push_action(config::system_account_name, "tolegacy"_n, config::system_account_name, mvo());
+   for (const auto& r : table) {
+      BOOST_REQUIRE(!get_row_by_id(config::system_account_name, eosio::chain::name{0}, blockinfo_table_name,
+                                   r.block_height)
+                        .empty());
+   }
+   BOOST_REQUIRE(!get_blockinfo_state().has_value());
+
+   // The first onblock action after the upgrade erases all the version 0 records at once.
+   set_code(config::system_account_name, contracts::system_wasm());
+   set_abi(config::system_account_name, contracts::system_abi().data());
+   produce_blocks(1);
+
+   table = get_blockinfo_table();
+   BOOST_REQUIRE_EQUAL(1, table.size());
+   BOOST_REQUIRE_EQUAL(1, table[0].version);
+   BOOST_REQUIRE(get_blockinfo_state().has_value());
+   BOOST_REQUIRE_EQUAL(table[0].block_height, get_blockinfo_state()->latest_block_height);
+   BOOST_REQUIRE_EQUAL(rolling_window_size, get_blockinfo_state()->rolling_window_size);
+}
+FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "contracts.hpp"
 #include "test_symbol.hpp"
+#include "../contracts/eosio.system/include/eosio.system/vote_weight.hpp"
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/testing/tester.hpp>
@@ -661,20 +662,47 @@ public:
    }
 
    action_result denynames(name acct, const std::vector<name>& patterns) {
-      return push_action(acct, "denynames"_n, mvo()("patterns", patterns));
+      auto res = push_action(acct, "denynames"_n, mvo()("patterns", patterns));
+      if (res == success()) {
+         for (auto n : patterns)
+            if (n.to_uint64_t() != 0 && (n.to_uint64_t() & 0xF) == 0 &&  // invalid patterns are ignored
+                std::find(denied_names.begin(), denied_names.end(), n) == denied_names.end())
+               denied_names.push_back(n);
+      }
+      return res;
    }
 
    action_result undenynames(name acct, const std::vector<name>& patterns) {
-      return push_action(acct, "undenynames"_n, mvo()("patterns", patterns));
+      auto res = push_action(acct, "undenynames"_n, mvo()("patterns", patterns));
+      if (res == success())
+         std::erase_if(denied_names, [&](name n) { return std::find(patterns.begin(), patterns.end(), n) != patterns.end(); });
+      return res;
    }
 
+   // returns the patterns of the legacy `acctdenylist` row and of the `acctdenyshrd` shards. The shards do not keep
+   // the order in which patterns were added, so patterns added with `denynames` above are returned in that order,
+   // followed by any other pattern sorted by value.
    std::vector<name> get_blacklisted_names() const {
+      std::vector<name> names;
       vector<char> data = get_row_by_id( config::system_account_name, config::system_account_name, "acctdenylist"_n, 0);
-      if (data.empty())
-         return {};
-      return abi_ser.binary_to_variant("account_name_blacklist", data, abi_serializer_max_time)["disallowed"].as<std::vector<name>>();
+      if (!data.empty())
+         names = abi_ser.binary_to_variant("account_name_blacklist", data, abi_serializer_max_time)["disallowed"].as<std::vector<name>>();
+
+      for (uint64_t size = 1; size <= 12; ++size) {
+         data = get_row_by_id( config::system_account_name, config::system_account_name, "acctdenyshrd"_n, size);
+         if (data.empty())
+            continue;
+         auto values = abi_ser.binary_to_variant("denylist_pattern_group", data, abi_serializer_max_time)["values"].as<std::vector<uint64_t>>();
+         for (auto v : values)
+            names.push_back(name{v << (64 - 5 * size)});
+      }
+      auto rank = [&](name n) { return std::find(denied_names.begin(), denied_names.end(), n) - denied_names.begin(); };
+      std::sort(names.begin(), names.end(), [&](name a, name b) { return std::pair{rank(a), a} < std::pair{rank(b), b}; });
+      return names;
    }
 
+   std::vector<name> denied_names; // patterns added with `denynames`, in the order they were added
+
    action_result push_action( const account_name& signer, const action_name &name, const variant_object &data, bool auth = true ) {
          if (name == "claimrewards"_n || name == "deposit"_n || name == "withdraw"_n || name == "unstaketorex"_n) {
             return push_vaulta_action(signer, name, data, auth);
@@ -973,6 +1001,10 @@ public:
       return push_action( name(user), "rexexec"_n, mvo()("user", user)("max", max) );
    }
 
+   action_result rexsettle( const account_name& user, uint16_t max ) {
+      return push_action( name(user), "rexsettle"_n, mvo()("user", user)("max", max) );
+   }
+
    action_result consolidate( const account_name& owner ) {
       return push_action( name(owner), "consolidate"_n, mvo()("owner", owner) );
    }
@@ -1061,7 +1093,28 @@ public:
 
    fc::variant get_rex_balance_obj( const account_name& act ) const {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "rexbal"_n, act );
-      return data.empty() ? fc::variant() : abi_ser.binary_to_variant("rex_balance", data, abi_serializer::create_yield_function(abi_serializer_max_time));
+      if ( data.empty() ) {
+         return fc::variant();
+      }
+
+      // present version 1 maturities, indexed by day, as the version 0 rex_maturities buckets
+      mvo balance( abi_ser.binary_to_variant("rex_balance", data, abi_serializer::create_yield_function(abi_serializer_max_time)) );
+      if ( balance.find( "maturity_days" ) != balance.end() ) {
+         const auto& days = balance["maturity_days"];
+         const uint32_t base_day = days["base_day"].as<uint32_t>();
+         const auto maturing = days["maturing"].as<std::vector<int64_t>>();
+         std::vector<fc::variant> maturities;
+         for ( size_t i = 0; i < maturing.size(); ++i ) {
+            if ( maturing[i] != 0 ) {
+               maturities.push_back( mvo()("first", time_point_sec( (base_day + 1 + i) * 24 * 3600 ))("second", maturing[i]) );
+            }
+         }
+         if ( days["savings"].as<int64_t>() != 0 ) {
+            maturities.push_back( mvo()("first", time_point_sec::maximum())("second", days["savings"]) );
+         }
+         balance["rex_maturities"] = maturities;
+      }
+      return balance;
    }
 
    asset get_rex_fund( const account_name& act ) const {
@@ -1110,6 +1163,16 @@ public:
       return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "rex_pool", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
    }
 
+   fc::variant get_rex_maintenance() const {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "rexmaint"_n, "rexmaint"_n );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "rex_maintenance", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
+   fc::variant get_system_status() const {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "sysstatus"_n, "sysstatus"_n );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "system_status", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    fc::variant get_rex_return_pool() const {
       vector<char> data;
       const auto& db = control->db();
@@ -1135,7 +1198,7 @@ public:
       vector<char> data;
       const auto& db = control->db();
       namespace chain = eosio::chain;
-      const auto* t_id = db.find<eosio::chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( config::system_account_name, config::system_account_name, "retbuckets"_n ) );
+      const auto* t_id = db.find<eosio::chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( config::system_account_name, config::system_account_name, "retring"_n ) );
       if ( !t_id ) {
          return fc::variant();
       }
@@ -1149,7 +1212,22 @@ public:
 
       data.resize( itr->value.size() );
       memcpy( data.data(), itr->value.data(), data.size() );
-      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "rex_return_buckets", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      if ( data.empty() ) {
+         return fc::variant();
+      }
+
+      // return the occupied slots of the ring, oldest first, in the layout of the former rex_return_buckets table
+      auto ring = abi_ser.binary_to_variant( "rex_return_ring", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      std::vector<fc::variant> buckets;
+      for ( const auto& bucket : ring["buckets"].get_array() ) {
+         if ( bucket["first"].as<time_point_sec>() != time_point_sec() ) {
+            buckets.push_back( bucket );
+         }
+      }
+      std::sort( buckets.begin(), buckets.end(), []( const fc::variant& a, const fc::variant& b ) {
+         return a["first"].as<time_point_sec>() < b["first"].as<time_point_sec>();
+      });
+      return mvo()( "version", ring["version"] )( "return_buckets", buckets );
    }
 
    void setup_rex_accounts( const std::vector<account_name>& accounts,
@@ -1266,14 +1344,43 @@ public:
       return get_voter_info( account_name(act) );
    }
 
+   // unpaid_blocks includes the blocks counted in the unpaidblocks table that have not been flushed yet
    fc::variant get_producer_info( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers"_n, act );
-      return abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      fc::variant prod = abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      const uint32_t pending = get_pending_unpaid_blocks( act );
+      if( pending == 0 ) {
+         return prod;
+      }
+      return mutable_variant_object( prod.get_object() )( "unpaid_blocks", prod["unpaid_blocks"].as<uint32_t>() + pending );
    }
    fc::variant get_producer_info( std::string_view act ) {
       return get_producer_info( account_name(act) );
    }
 
+   uint32_t get_pending_unpaid_blocks( const account_name& act ) {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "unpaidblocks"_n, act );
+      return data.empty() ? 0 : abi_ser.binary_to_variant( "unpaid_blocks_counter", data, abi_serializer::create_yield_function(abi_serializer_max_time) )["unpaid_blocks"].as<uint32_t>();
+   }
+
+   uint32_t get_total_pending_unpaid_blocks() {
+      const auto& db = control->db();
+      namespace chain = eosio::chain;
+      const auto* t_id = db.find<eosio::chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( config::system_account_name, config::system_account_name, "unpaidblocks"_n ) );
+      if ( !t_id ) {
+         return 0;
+      }
+
+      const auto& idx = db.get_index<chain::key_value_index, chain::by_scope_primary>();
+
+      uint32_t total = 0;
+      for ( auto itr = idx.lower_bound( boost::make_tuple( t_id->id, 0 ) ); itr != idx.end() && itr->t_id == t_id->id; ++itr ) {
+         vector<char> data( itr->value.data(), itr->value.data() + itr->value.size() );
+         total += abi_ser.binary_to_variant( "unpaid_blocks_counter", data, abi_serializer::create_yield_function(abi_serializer_max_time) )["unpaid_blocks"].as<uint32_t>();
+      }
+      return total;
+   }
+
    fc::variant get_producer_info2( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers2"_n, act );
       return abi_ser.binary_to_variant( "producer_info2", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
@@ -1282,6 +1389,18 @@ public:
       return get_producer_info2( account_name(act) );
    }
 
+   // votepay share state of a producer, read from its producers row or, if not yet migrated, from the legacy producers2 row
+   fc::variant get_producer_votepay_state( const account_name& act ) {
+      const auto prod = get_producer_info( act );
+      if( prod.get_object().contains("votepay_state") ) {
+         return prod["votepay_state"];
+      }
+      return get_producer_info2( act );
+   }
+   fc::variant get_producer_votepay_state( std::string_view act ) {
+      return get_producer_votepay_state( account_name(act) );
+   }
+
    void create_currency( name contract, name manager, asset maxsupply ) {
       auto act =  mutable_variant_object()
          ("issuer",       manager )
@@ -1381,7 +1500,8 @@ public:
 
    double stake2votes( asset stake ) {
       auto now = control->pending_block_time().time_since_epoch().count() / 1000000;
-      return stake.get_amount() * pow(2, int64_t((now - (config::block_timestamp_epoch / 1000)) / (86400 * 7))/ double(52) ); // 52 week periods (i.e. ~years)
+      const int64_t week = (now - (config::block_timestamp_epoch / 1000)) / (86400 * 7);
+      return stake.get_amount() * eosiosystem::vote_weight::multiplier( week ); // 52 week periods (i.e. ~years)
    }
 
    double stake2votes( const string& s ) {
@@ -1403,10 +1523,17 @@ public:
       return static_cast<uint64_t>( time_point::from_iso_string( v.as_string() ).time_since_epoch().count() );
    }
 
+   // total_unpaid_blocks includes the blocks counted in the unpaidblocks table that have not been flushed yet
    fc::variant get_global_state() {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "global"_n, "global"_n );
       if (data.empty()) std::cout << "\nData is empty\n" << std::endl;
-      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "eosio_global_state", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      if (data.empty()) return fc::variant();
+      fc::variant gstate = abi_ser.binary_to_variant( "eosio_global_state", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      const uint32_t pending = get_total_pending_unpaid_blocks();
+      if( pending == 0 ) {
+         return gstate;
+      }
+      return mutable_variant_object( gstate.get_object() )( "total_unpaid_blocks", gstate["total_unpaid_blocks"].as<uint32_t>() + pending );
    }
 
    fc::variant get_global_state2() {
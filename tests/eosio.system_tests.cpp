@@ -3,13 +3,17 @@
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <fc/log/logger.hpp>
 #include <eosio/chain/exceptions.hpp>
 
 #include "eosio.system_tester.hpp"
+#include "../contracts/eosio.system/include/eosio.system/canon_name_core.hpp"
+
 struct _abi_hash {
    name owner;
    fc::sha256 hash;
@@ -747,6 +751,46 @@ BOOST_FIXTURE_TEST_CASE( stake_to_another_user_not_from_refund, eosio_system_tes
 
 } FC_LOG_AND_RETHROW()
 
+// the vote weight multiplier no longer calls std::pow, so bound its difference from std::pow(2, week / 52.0) over every
+// week it covers, and past them where it falls back to std::pow
+BOOST_AUTO_TEST_CASE( vote_weight_multiplier ) try {
+   using eosiosystem::vote_weight::multiplier;
+   constexpr int64_t last_week = 64 * 52 + 104;
+
+   double max_error = 0;
+   for( int64_t week = -104; week < last_week; ++week ) {
+      const double expected = std::pow( 2, week / double( 52 ) );
+      const double error    = std::abs( multiplier( week ) - expected ) / expected;
+      // week / 52.0 is rounded by up to half an ulp, which std::pow scales by ln(2) * week / 52 at most
+      const double bound    = ( 2 + std::abs( week ) / 52.0 ) * std::numeric_limits<double>::epsilon();
+      BOOST_REQUIRE_MESSAGE( error <= bound, "week " << week << ": relative error " << error << " exceeds " << bound );
+      max_error = std::max( max_error, error );
+      if( week >= 0 && week % 52 == 0 && week < 64 * 52 ) {
+         BOOST_REQUIRE_EQUAL( multiplier( week ), std::ldexp( 1.0, week / 52 ) ); // whole periods are exact
+      }
+   }
+   for( int64_t week = 0; week < 52; ++week ) { // the table holds the closest doubles to 2^(w/52)
+      BOOST_REQUIRE( std::abs( eosiosystem::vote_weight::weekly_fractions[week] - std::pow( 2, week / double( 52 ) ) )
+                     <= std::numeric_limits<double>::epsilon() );
+   }
+   BOOST_TEST_MESSAGE( "vote weight multiplier: max relative error from std::pow " << max_error );
+
+   // microbenchmark, logged only
+   auto time = [&]( auto&& f ) {
+      double sum   = 0;
+      auto   start = std::chrono::steady_clock::now();
+      for( int round = 0; round < 100; ++round )
+         for( int64_t week = 0; week < last_week; ++week )
+            sum += f( week );
+      auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start );
+      return std::pair{ elapsed.count(), sum };
+   };
+   auto [pow_us, pow_sum]     = time( []( int64_t week ) { return std::pow( 2, week / double( 52 ) ); } );
+   auto [table_us, table_sum] = time( []( int64_t week ) { return multiplier( week ); } );
+   BOOST_TEST_MESSAGE( "vote weight multiplier of " << 100 * last_week << " weeks: std::pow " << pow_us
+                       << " us (sum " << pow_sum << "), table " << table_us << " us (sum " << table_sum << ")" );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE(eosio_system_producer_tests)
 
@@ -1455,6 +1499,183 @@ BOOST_FIXTURE_TEST_CASE( proxy_actions_affect_producers, eosio_system_tester, *
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( proxy_defers_small_weight_changes, eosio_system_tester, * boost::unit_test::tolerance(1e-10) ) try {
+   cross_15_percent_threshold();
+
+   create_accounts_with_resources( {  "defproducer1"_n, "defproducer2"_n } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer1"_n, 1) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer2"_n, 2) );
+
+   //register as a proxy and vote with a large stake
+   BOOST_REQUIRE_EQUAL( success(), push_action( "alice1111111"_n, "regproxy"_n, mvo()
+                                                ("proxy",  "alice1111111")
+                                                ("isproxy", true)
+                        )
+   );
+   issue_and_transfer( "alice1111111", core_sym::from_string("100000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", core_sym::from_string("50000.0000"), core_sym::from_string("50000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote("alice1111111"_n, { "defproducer1"_n, "defproducer2"_n } ) );
+   const double alice_weight = stake2votes(core_sym::from_string("100000.0000"));
+   BOOST_TEST_REQUIRE( alice_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+
+   //a small delegation is accumulated by the proxy without updating its producers
+   issue_and_transfer( "bob111111111", core_sym::from_string("1000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("5.0000"), core_sym::from_string("5.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote("bob111111111"_n, vector<account_name>(), "alice1111111"_n ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("10.0000")) == get_voter_info( "alice1111111" )["proxied_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( alice_weight == get_voter_info( "alice1111111" )["last_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( alice_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( alice_weight == get_producer_info( "defproducer2" )["total_votes"].as_double() );
+
+   //once the accumulated change crosses the threshold it is propagated in full
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   const double total_weight = stake2votes(core_sym::from_string("100210.0000"));
+   BOOST_TEST_REQUIRE( total_weight == get_voter_info( "alice1111111" )["last_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( total_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( total_weight == get_producer_info( "defproducer2" )["total_votes"].as_double() );
+
+   //small changes are pending again, until the proxy updates its own vote
+   BOOST_REQUIRE_EQUAL( success(), unstake( "bob111111111", core_sym::from_string("5.0000"), core_sym::from_string("5.0000") ) );
+   BOOST_TEST_REQUIRE( total_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( success(), vote("alice1111111"_n, { "defproducer1"_n, "defproducer2"_n } ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100200.0000")) == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100200.0000")) == get_producer_info( "defproducer2" )["total_votes"].as_double() );
+
+   //any account can apply the pending change of a proxy with proxyupdate
+   BOOST_REQUIRE_EQUAL( success(), unstake( "bob111111111", core_sym::from_string("5.0000"), core_sym::from_string("5.0000") ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100200.0000")) == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( success(), push_action( "carol1111111"_n, "proxyupdate"_n, mvo()("proxy", "alice1111111") ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100190.0000")) == get_voter_info( "alice1111111" )["last_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100190.0000")) == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100190.0000")) == get_producer_info( "defproducer2" )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "proxy not found" ),
+                        push_action( "carol1111111"_n, "proxyupdate"_n, mvo()("proxy", "bob111111111") ) );
+
+   //unregistering as a proxy removes the proxied weight from the producers
+   BOOST_REQUIRE_EQUAL( success(), push_action( "alice1111111"_n, "regproxy"_n, mvo()("proxy", "alice1111111")("isproxy", false) ) );
+   BOOST_TEST_REQUIRE( alice_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( success(), unstake( "bob111111111", core_sym::from_string("50.0000"), core_sym::from_string("50.0000") ) );
+   BOOST_TEST_REQUIRE( alice_weight == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+
+   //registering again applies the proxied weight in full, even below the threshold
+   BOOST_REQUIRE_EQUAL( success(), push_action( "alice1111111"_n, "regproxy"_n, mvo()("proxy", "alice1111111")("isproxy", true) ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100090.0000")) == get_voter_info( "alice1111111" )["last_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100090.0000")) == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("100090.0000")) == get_producer_info( "defproducer2" )["total_votes"].as_double() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( producer_ranking_change_tracking, eosio_system_tester ) try {
+   cross_15_percent_threshold();
+
+   create_accounts_with_resources( {  "defproducer1"_n, "defproducer2"_n } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer1"_n, 1) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer2"_n, 2) );
+   BOOST_REQUIRE_EQUAL( false, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   //the next schedule update evaluates the ranking
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   //votes change the ranking
+   issue_and_transfer( "bob111111111", core_sym::from_string("1000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "defproducer1"_n } ) );
+   BOOST_REQUIRE_EQUAL( false, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   auto convert_to_block_timestamp = [](const fc::variant& timestamp) -> eosio::chain::block_timestamp_type {
+      return fc::time_point::from_iso_string(timestamp.as_string());
+   };
+   const auto schedule_update1 = convert_to_block_timestamp(get_global_state()["last_producer_schedule_update"]);
+
+   //schedule updates without any change keep the ranking and still advance last_producer_schedule_update
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+   const auto schedule_update2 = convert_to_block_timestamp(get_global_state()["last_producer_schedule_update"]);
+   BOOST_REQUIRE( schedule_update1 < schedule_update2 );
+
+   //more votes for the elected producer keep it elected, so the next schedule update still skips the evaluation
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+   BOOST_REQUIRE( schedule_update2 < convert_to_block_timestamp(get_global_state()["last_producer_schedule_update"]) );
+
+   //votes for a producer left out change the ranking
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "defproducer1"_n, "defproducer2"_n } ) );
+   BOOST_REQUIRE_EQUAL( false, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   //unregistering a producer changes the ranking
+   BOOST_REQUIRE_EQUAL( success(), push_action( "defproducer1"_n, "unregprod"_n, mvo()
+                                                ("producer",  "defproducer1")
+                        )
+   );
+   BOOST_REQUIRE_EQUAL( false, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( producer_ranking_after_upgrade, eosio_system_tester ) try {
+   cross_15_percent_threshold();
+
+   create_accounts_with_resources( {  "defproducer1"_n } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer1"_n, 1) );
+   issue_and_transfer( "bob111111111", core_sym::from_string("1000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "defproducer1"_n } ) );
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   const auto producers_hash = get_global_state2()["last_proposed_producers_hash"].as_string();
+
+   //a contract older than 3.11.0 drops the fields it doesn't know from global2
+   set_code( config::system_account_name, contracts::util::system_wasm_v1_8() );
+   set_abi(  config::system_account_name, contracts::util::system_abi_v1_8().data() );
+   produce_blocks(2);
+   set_code( config::system_account_name, contracts::system_wasm() );
+   set_abi(  config::system_account_name, contracts::system_abi().data() );
+   BOOST_REQUIRE( !get_global_state2().get_object().contains("last_proposed_producers_hash") );
+   BOOST_REQUIRE( !get_global_state2().get_object().contains("producer_ranking_unchanged") );
+
+   //schedule updates after the upgrade cannot propose the unchanged schedule, and without a recorded hash they
+   //cannot tell whether it was the last one proposed, so they keep evaluating the ranking
+   const std::string no_hash( 64, '0' );
+   for( int i = 0; i < 2; ++i ) {
+      produce_block( fc::minutes(2) );
+      produce_blocks(2);
+      BOOST_REQUIRE_EQUAL( no_hash, get_global_state2()["last_proposed_producers_hash"].as_string() );
+      BOOST_REQUIRE_EQUAL( false, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+   }
+
+   //until a new schedule is proposed, after which the updates are skipped again
+   create_accounts_with_resources( {  "defproducer2"_n } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "defproducer2"_n, 2) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "defproducer1"_n, "defproducer2"_n } ) );
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_NE( no_hash, get_global_state2()["last_proposed_producers_hash"].as_string() );
+   BOOST_REQUIRE_NE( producers_hash, get_global_state2()["last_proposed_producers_hash"].as_string() );
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+   produce_block( fc::minutes(2) );
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL( true, get_global_state2()["producer_ranking_unchanged"].as_bool() );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(producer_pay, eosio_system_tester, * boost::unit_test::tolerance(1e-10)) try {
 
    const double continuous_rate = std::log1p(double(0.05));
@@ -1671,6 +1892,60 @@ BOOST_FIXTURE_TEST_CASE(producer_pay, eosio_system_tester, * boost::unit_test::t
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE(eosio_system_inflation_tests)
 
+BOOST_FIXTURE_TEST_CASE(unpaid_blocks_counter, eosio_system_tester) try {
+   const asset large_asset = core_sym::from_string("80.0000");
+   create_account_with_resources( "defproducera"_n, config::system_account_name, core_sym::from_string("1.0000"), false, large_asset, large_asset );
+   create_account_with_resources( "producvotera"_n, config::system_account_name, core_sym::from_string("1.0000"), false, large_asset, large_asset );
+
+   BOOST_REQUIRE_EQUAL(success(), regproducer("defproducera"_n));
+   transfer( config::system_account_name, "producvotera", core_sym::from_string("400000000.0000"), config::system_account_name);
+   BOOST_REQUIRE_EQUAL(success(), stake("producvotera", core_sym::from_string("100000000.0000"), core_sym::from_string("100000000.0000")));
+   BOOST_REQUIRE_EQUAL(success(), vote( "producvotera"_n, { "defproducera"_n }));
+   produce_blocks(50);
+
+   // unpaid_blocks as stored in the producers row, without the blocks still pending in the unpaidblocks table
+   auto stored_unpaid_blocks = [&]() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers"_n, "defproducera"_n );
+      return abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) )["unpaid_blocks"].as<uint32_t>();
+   };
+
+   // The tester starts building the next block right after producing one, and that block counts itself in its
+   // onblock. Counts read between blocks therefore include it, and it is discarded when the next produce_block skips
+   // ahead in time.
+
+   // counts are flushed into the producers row at the next producer schedule update
+   produce_block(fc::minutes(2));
+   BOOST_REQUIRE_EQUAL(1, get_pending_unpaid_blocks("defproducera"_n));
+   const uint32_t flushed = stored_unpaid_blocks();
+   BOOST_REQUIRE(0 < flushed);
+
+   // in between, blocks are only counted in the unpaidblocks table
+   produce_blocks(10);
+   BOOST_REQUIRE_EQUAL(11, get_pending_unpaid_blocks("defproducera"_n));
+   BOOST_REQUIRE_EQUAL(flushed, stored_unpaid_blocks());
+   BOOST_REQUIRE_EQUAL(flushed + 11, get_producer_info("defproducera")["unpaid_blocks"].as<uint32_t>());
+
+   // the 10 blocks produced and the one produced 2 minutes later
+   produce_block(fc::minutes(2));
+   BOOST_REQUIRE_EQUAL(1, get_pending_unpaid_blocks("defproducera"_n));
+   BOOST_REQUIRE_EQUAL(flushed + 11, stored_unpaid_blocks());
+
+   // claimrewards flushes the pending counts before paying
+   produce_block(fc::hours(24));
+   produce_blocks(10);
+   BOOST_REQUIRE_EQUAL(11, get_pending_unpaid_blocks("defproducera"_n));
+   BOOST_REQUIRE_EQUAL(success(), push_action("defproducera"_n, "claimrewards"_n, mvo()("owner", "defproducera")));
+   BOOST_REQUIRE_EQUAL(0, stored_unpaid_blocks());
+   BOOST_REQUIRE_EQUAL(1, get_producer_info("defproducera")["unpaid_blocks"].as<uint32_t>());
+   BOOST_REQUIRE_EQUAL(1, get_global_state()["total_unpaid_blocks"].as<uint32_t>());
+
+   // the counter row is kept across flushes
+   control->abort_block();
+   BOOST_REQUIRE(!get_row_by_account( config::system_account_name, config::system_account_name, "unpaidblocks"_n, "defproducera"_n ).empty());
+   BOOST_REQUIRE_EQUAL(0, get_pending_unpaid_blocks("defproducera"_n));
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(change_inflation, eosio_system_tester) try {
 
    {
@@ -2137,7 +2412,7 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_pay, eosio_system_tester, * boost::uni
       const auto prod_name = producer_names[prod_index];
 
       const auto     initial_prod_info         = get_producer_info(prod_name);
-      const auto     initial_prod_info2        = get_producer_info2(prod_name);
+      const auto     initial_prod_info2        = get_producer_votepay_state(prod_name);
       const auto     initial_global_state      = get_global_state();
       const double   initial_tot_votepay_share = get_global_state2()["total_producer_votepay_share"].as_double();
       const double   initial_tot_vpay_rate     = get_global_state3()["total_vpay_share_change_rate"].as_double();
@@ -2152,11 +2427,11 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_pay, eosio_system_tester, * boost::uni
       [[maybe_unused]] const uint64_t initial_claim_time = microseconds_since_epoch_of_iso_string( initial_prod_info["last_claim_time"] );
       const uint64_t initial_prod_update_time  = microseconds_since_epoch_of_iso_string( initial_prod_info2["last_votepay_share_update"] );
 
-      BOOST_TEST_REQUIRE( 0 == get_producer_info2(prod_name)["votepay_share"].as_double() );
+      BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(prod_name)["votepay_share"].as_double() );
       BOOST_REQUIRE_EQUAL( success(), push_action(prod_name, "claimrewards"_n, mvo()("owner", prod_name) ) );
 
       const auto     prod_info         = get_producer_info(prod_name);
-      const auto     prod_info2        = get_producer_info2(prod_name);
+      const auto     prod_info2        = get_producer_votepay_state(prod_name);
       const auto     global_state      = get_global_state();
       const uint64_t vpay_state_update = microseconds_since_epoch_of_iso_string( get_global_state3()["last_vpay_state_update"] );
       const uint64_t bucket_fill_time  = microseconds_since_epoch_of_iso_string( global_state["last_pervote_bucket_fill"] );
@@ -2188,7 +2463,7 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_pay, eosio_system_tester, * boost::uni
       BOOST_REQUIRE( 100 * 10000 < from_pervote_bucket );
       BOOST_CHECK_EQUAL( expected_pervote_bucket - from_pervote_bucket, pervote_bucket );
       BOOST_CHECK_EQUAL( from_perblock_bucket + from_pervote_bucket, balance.get_amount() - initial_balance.get_amount() );
-      BOOST_TEST_REQUIRE( 0 == get_producer_info2(prod_name)["votepay_share"].as_double() );
+      BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(prod_name)["votepay_share"].as_double() );
 
       produce_block(fc::hours(2));
 
@@ -2236,8 +2511,8 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_votepay_share, eosio_system_tester, *
          ilog( "------ get pro----------" );
          wdump((p));
          BOOST_TEST_REQUIRE(0 == get_producer_info(p)["total_votes"].as_double());
-         BOOST_TEST_REQUIRE(0 == get_producer_info2(p)["votepay_share"].as_double());
-         BOOST_REQUIRE(0 < microseconds_since_epoch_of_iso_string( get_producer_info2(p)["last_votepay_share_update"] ));
+         BOOST_TEST_REQUIRE(0 == get_producer_votepay_state(p)["votepay_share"].as_double());
+         BOOST_REQUIRE(0 < microseconds_since_epoch_of_iso_string( get_producer_votepay_state(p)["last_votepay_share_update"] ));
       }
    }
 
@@ -2253,22 +2528,22 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_votepay_share, eosio_system_tester, *
       produce_block( fc::hours(10) );
       BOOST_TEST_REQUIRE( 0 == get_global_state2()["total_producer_votepay_share"].as_double() );
       const auto& init_info  = get_producer_info(producer_names[0]);
-      const auto& init_info2 = get_producer_info2(producer_names[0]);
+      const auto& init_info2 = get_producer_votepay_state(producer_names[0]);
       uint64_t init_update = microseconds_since_epoch_of_iso_string( init_info2["last_votepay_share_update"] );
       double   init_votes  = init_info["total_votes"].as_double();
       BOOST_REQUIRE_EQUAL( success(), vote("producvoterb"_n, vector<account_name>(producer_names.begin(), producer_names.begin()+21)) );
       const auto& info  = get_producer_info(producer_names[0]);
-      const auto& info2 = get_producer_info2(producer_names[0]);
+      const auto& info2 = get_producer_votepay_state(producer_names[0]);
       BOOST_TEST_REQUIRE( ((microseconds_since_epoch_of_iso_string( info2["last_votepay_share_update"] ) - init_update)/double(1E6)) * init_votes == info2["votepay_share"].as_double() );
       BOOST_TEST_REQUIRE( info2["votepay_share"].as_double() * 10 == get_global_state2()["total_producer_votepay_share"].as_double() );
 
-      BOOST_TEST_REQUIRE( 0 == get_producer_info2(producer_names[11])["votepay_share"].as_double() );
+      BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(producer_names[11])["votepay_share"].as_double() );
       produce_block( fc::hours(13) );
       BOOST_REQUIRE_EQUAL( success(), vote("producvoterc"_n, vector<account_name>(producer_names.begin(), producer_names.begin()+26)) );
-      BOOST_REQUIRE( 0 < get_producer_info2(producer_names[11])["votepay_share"].as_double() );
+      BOOST_REQUIRE( 0 < get_producer_votepay_state(producer_names[11])["votepay_share"].as_double() );
       produce_block( fc::hours(1) );
       BOOST_REQUIRE_EQUAL( success(), vote("producvoterd"_n, vector<account_name>(producer_names.begin()+26, producer_names.end())) );
-      BOOST_TEST_REQUIRE( 0 == get_producer_info2(producer_names[26])["votepay_share"].as_double() );
+      BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(producer_names[26])["votepay_share"].as_double() );
    }
 
    {
@@ -2299,7 +2574,7 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_votepay_share, eosio_system_tester, *
       }
       BOOST_TEST_REQUIRE( total_votes == get_global_state()["total_producer_vote_weight"].as_double() );
       BOOST_TEST_REQUIRE( total_votes == get_global_state3()["total_vpay_share_change_rate"].as_double() );
-      BOOST_REQUIRE_EQUAL( microseconds_since_epoch_of_iso_string( get_producer_info2(producer_names.back())["last_votepay_share_update"] ),
+      BOOST_REQUIRE_EQUAL( microseconds_since_epoch_of_iso_string( get_producer_votepay_state(producer_names.back())["last_votepay_share_update"] ),
                            microseconds_since_epoch_of_iso_string( get_global_state3()["last_vpay_state_update"] ) );
 
       std::for_each( vote_shares.begin(), vote_shares.end(), [total_votes](double& x) { x /= total_votes; } );
@@ -2315,7 +2590,7 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_votepay_share, eosio_system_tester, *
       double expected_total_votepay_shares = 0;
       for (uint32_t i = 0; i < producer_names.size() ; ++i) {
          const auto& info  = get_producer_info(producer_names[i]);
-         const auto& info2 = get_producer_info2(producer_names[i]);
+         const auto& info2 = get_producer_votepay_state(producer_names[i]);
          votepay_shares[i] = info2["votepay_share"].as_double();
          total_votepay_shares          += votepay_shares[i];
          expected_total_votepay_shares += votepay_shares[i];
@@ -2332,22 +2607,22 @@ BOOST_FIXTURE_TEST_CASE(multiple_producer_votepay_share, eosio_system_tester, *
       const uint32_t prod_index = 15;
       const account_name prod_name = producer_names[prod_index];
       const auto& init_info        = get_producer_info(prod_name);
-      const auto& init_info2       = get_producer_info2(prod_name);
+      const auto& init_info2       = get_producer_votepay_state(prod_name);
       BOOST_REQUIRE( 0 < init_info2["votepay_share"].as_double() );
       BOOST_REQUIRE( 0 < microseconds_since_epoch_of_iso_string( init_info2["last_votepay_share_update"] ) );
 
       BOOST_REQUIRE_EQUAL( success(), push_action(prod_name, "claimrewards"_n, mvo()("owner", prod_name)) );
 
-      BOOST_TEST_REQUIRE( 0 == get_producer_info2(prod_name)["votepay_share"].as_double() );
+      BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(prod_name)["votepay_share"].as_double() );
       BOOST_REQUIRE_EQUAL( get_producer_info(prod_name)["last_claim_time"].as_string(),
-                           get_producer_info2(prod_name)["last_votepay_share_update"].as_string() );
+                           get_producer_votepay_state(prod_name)["last_votepay_share_update"].as_string() );
       BOOST_REQUIRE_EQUAL( get_producer_info(prod_name)["last_claim_time"].as_string(),
                            get_global_state3()["last_vpay_state_update"].as_string() );
       const auto& gs3 = get_global_state3();
       double expected_total_votepay_shares = 0;
       for (uint32_t i = 0; i < producer_names.size(); ++i) {
          const auto& info  = get_producer_info(producer_names[i]);
-         const auto& info2 = get_producer_info2(producer_names[i]);
+         const auto& info2 = get_producer_votepay_state(producer_names[i]);
          expected_total_votepay_shares += info2["votepay_share"].as_double();
          expected_total_votepay_shares += info["total_votes"].as_double()
                                            * double( ( microseconds_since_epoch_of_iso_string( gs3["last_vpay_state_update"] )
@@ -2386,35 +2661,36 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_invariant, eosio_system_tester, * boost::u
 
    produce_block( fc::hours(25) );
 
-   BOOST_REQUIRE_EQUAL( success(), vote( vota, { proda } ) );
-   BOOST_REQUIRE_EQUAL( success(), vote( votb, { prodb } ) );
+   // re-voting with an unchanged vote weight does not update the producers, so the voters change their stake instead
+   BOOST_REQUIRE_EQUAL( success(), stake( vota, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), stake( votb, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
 
    produce_block( fc::hours(1) );
 
    BOOST_REQUIRE_EQUAL( success(), push_action(proda, "claimrewards"_n, mvo()("owner", proda)) );
-   BOOST_TEST_REQUIRE( 0 == get_producer_info2(proda)["votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(proda)["votepay_share"].as_double() );
 
    produce_block( fc::hours(24) );
 
-   BOOST_REQUIRE_EQUAL( success(), vote( vota, { proda } ) );
+   BOOST_REQUIRE_EQUAL( success(), stake( vota, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
 
    produce_block( fc::hours(24) );
 
    BOOST_REQUIRE_EQUAL( success(), push_action(prodb, "claimrewards"_n, mvo()("owner", prodb)) );
-   BOOST_TEST_REQUIRE( 0 == get_producer_info2(prodb)["votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(prodb)["votepay_share"].as_double() );
 
    produce_block( fc::hours(10) );
 
-   BOOST_REQUIRE_EQUAL( success(), vote( votb, { prodb } ) );
+   BOOST_REQUIRE_EQUAL( success(), stake( votb, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
 
    produce_block( fc::hours(16) );
 
-   BOOST_REQUIRE_EQUAL( success(), vote( votb, { prodb } ) );
+   BOOST_REQUIRE_EQUAL( success(), stake( votb, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
    produce_block( fc::hours(2) );
-   BOOST_REQUIRE_EQUAL( success(), vote( vota, { proda } ) );
+   BOOST_REQUIRE_EQUAL( success(), stake( vota, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
 
    const auto& info  = get_producer_info(prodb);
-   const auto& info2 = get_producer_info2(prodb);
+   const auto& info2 = get_producer_votepay_state(prodb);
    const auto& gs2   = get_global_state2();
    const auto& gs3   = get_global_state3();
 
@@ -2461,20 +2737,22 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_proxy, eosio_system_tester, * boost::unit_
    BOOST_REQUIRE_EQUAL( success(), vote( alice, { carol } ) );
    double total_votes = get_producer_info(carol)["total_votes"].as_double();
    BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("450.0003")) == total_votes );
-   BOOST_TEST_REQUIRE( 0 == get_producer_info2(carol)["votepay_share"].as_double() );
-   uint64_t last_update_time = microseconds_since_epoch_of_iso_string( get_producer_info2(carol)["last_votepay_share_update"] );
+   BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(carol)["votepay_share"].as_double() );
+   uint64_t last_update_time = microseconds_since_epoch_of_iso_string( get_producer_votepay_state(carol)["last_votepay_share_update"] );
 
    produce_block( fc::hours(15) );
 
    // alice (proxy) votes again for carol
+   // carol is only updated if the vote weight of alice has changed in the meantime
    BOOST_REQUIRE_EQUAL( success(), vote( alice, { carol } ) );
-   auto cur_info2 = get_producer_info2(carol);
+   auto cur_info2 = get_producer_votepay_state(carol);
    double expected_votepay_share = double( (microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] ) - last_update_time) / 1E6 ) * total_votes;
    BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("450.0003")) == get_producer_info(carol)["total_votes"].as_double() );
    BOOST_TEST_REQUIRE( expected_votepay_share == cur_info2["votepay_share"].as_double() );
-   BOOST_TEST_REQUIRE( expected_votepay_share == get_global_state2()["total_producer_votepay_share"].as_double() );
    last_update_time = microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] );
    total_votes      = get_producer_info(carol)["total_votes"].as_double();
+   BOOST_TEST_REQUIRE( expected_votepay_share + total_votes * double( (microseconds_since_epoch_of_iso_string( get_global_state3()["last_vpay_state_update"] ) - last_update_time) / 1E6 )
+                       == get_global_state2()["total_producer_votepay_share"].as_double() );
 
    produce_block( fc::hours(40) );
 
@@ -2482,7 +2760,7 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_proxy, eosio_system_tester, * boost::unit_
    BOOST_REQUIRE_EQUAL( success(), unstake( bob, core_sym::from_string("10.0002"), core_sym::from_string("10.0001") ) );
    BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("430.0000")), get_producer_info(carol)["total_votes"].as_double() );
 
-   cur_info2 = get_producer_info2(carol);
+   cur_info2 = get_producer_votepay_state(carol);
    expected_votepay_share += double( (microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] ) - last_update_time) / 1E6 ) * total_votes;
    BOOST_TEST_REQUIRE( expected_votepay_share == cur_info2["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( expected_votepay_share == get_global_state2()["total_producer_votepay_share"].as_double() );
@@ -2497,39 +2775,39 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_proxy, eosio_system_tester, * boost::unit_
    // bob votes for carol
    BOOST_REQUIRE_EQUAL( success(), vote( bob, { carol } ) );
    BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("430.0000")), get_producer_info(carol)["total_votes"].as_double() );
-   cur_info2 = get_producer_info2(carol);
+   cur_info2 = get_producer_votepay_state(carol);
    expected_votepay_share = double( (microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] ) - last_update_time) / 1E6 ) * total_votes;
    BOOST_TEST_REQUIRE( expected_votepay_share == cur_info2["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( expected_votepay_share == get_global_state2()["total_producer_votepay_share"].as_double() );
 
    produce_block( fc::hours(54) );
 
-   // bob votes for carol again
+   // bob increases his stake, which updates his vote for carol
    // carol hasn't claimed rewards in over 3 days
-   total_votes = get_producer_info(carol)["total_votes"].as_double();
-   BOOST_REQUIRE_EQUAL( success(), vote( bob, { carol } ) );
-   BOOST_REQUIRE_EQUAL( get_producer_info2(carol)["last_votepay_share_update"].as_string(),
+   BOOST_REQUIRE_EQUAL( success(), stake( bob, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
+   BOOST_REQUIRE_EQUAL( get_producer_votepay_state(carol)["last_votepay_share_update"].as_string(),
                         get_global_state3()["last_vpay_state_update"].as_string() );
-   BOOST_TEST_REQUIRE( 0 == get_producer_info2(carol)["votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(carol)["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0 == get_global_state2()["total_producer_votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0 == get_global_state3()["total_vpay_share_change_rate"].as_double() );
 
    produce_block( fc::hours(20) );
 
-   // bob votes for carol again
+   // bob increases his stake again
    // carol still hasn't claimed rewards
-   BOOST_REQUIRE_EQUAL( success(), vote( bob, { carol } ) );
-   BOOST_REQUIRE_EQUAL(get_producer_info2(carol)["last_votepay_share_update"].as_string(),
+   BOOST_REQUIRE_EQUAL( success(), stake( bob, core_sym::from_string("1.0000"), core_sym::from_string("1.0000") ) );
+   BOOST_REQUIRE_EQUAL(get_producer_votepay_state(carol)["last_votepay_share_update"].as_string(),
                        get_global_state3()["last_vpay_state_update"].as_string() );
-   BOOST_TEST_REQUIRE( 0 == get_producer_info2(carol)["votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( 0 == get_producer_votepay_state(carol)["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0 == get_global_state2()["total_producer_votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0 == get_global_state3()["total_vpay_share_change_rate"].as_double() );
+   total_votes = get_producer_info(carol)["total_votes"].as_double();
 
    produce_block( fc::hours(24) );
 
    // carol finally claims rewards
    BOOST_REQUIRE_EQUAL( success(), push_action( carol, "claimrewards"_n, mvo()("owner", carol) ) );
-   BOOST_TEST_REQUIRE( 0           == get_producer_info2(carol)["votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( 0           == get_producer_votepay_state(carol)["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0           == get_global_state2()["total_producer_votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( total_votes == get_global_state3()["total_vpay_share_change_rate"].as_double() );
 
@@ -2537,19 +2815,20 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_proxy, eosio_system_tester, * boost::unit_
 
    // alice votes for carol and emily
    // emily hasn't claimed rewards in over 3 days
-   last_update_time = microseconds_since_epoch_of_iso_string( get_producer_info2(carol)["last_votepay_share_update"] );
+   // carol is only updated if the vote weight of alice has changed since her last vote
+   last_update_time = microseconds_since_epoch_of_iso_string( get_producer_votepay_state(carol)["last_votepay_share_update"] );
    BOOST_REQUIRE_EQUAL( success(), vote( alice, { carol, emily } ) );
-   cur_info2 = get_producer_info2(carol);
-   auto cur_info2_emily = get_producer_info2(emily);
+   cur_info2 = get_producer_votepay_state(carol);
+   auto cur_info2_emily = get_producer_votepay_state(emily);
 
    expected_votepay_share = double( (microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] ) - last_update_time) / 1E6 ) * total_votes;
+   last_update_time       = microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] );
+   total_votes            = get_producer_info(carol)["total_votes"].as_double();
    BOOST_TEST_REQUIRE( expected_votepay_share == cur_info2["votepay_share"].as_double() );
    BOOST_TEST_REQUIRE( 0                      == cur_info2_emily["votepay_share"].as_double() );
-   BOOST_TEST_REQUIRE( expected_votepay_share == get_global_state2()["total_producer_votepay_share"].as_double() );
-   BOOST_TEST_REQUIRE( get_producer_info(carol)["total_votes"].as_double() ==
-                       get_global_state3()["total_vpay_share_change_rate"].as_double() );
-   BOOST_REQUIRE_EQUAL( cur_info2["last_votepay_share_update"].as_string(),
-                        get_global_state3()["last_vpay_state_update"].as_string() );
+   BOOST_TEST_REQUIRE( expected_votepay_share + total_votes * double( (microseconds_since_epoch_of_iso_string( get_global_state3()["last_vpay_state_update"] ) - last_update_time) / 1E6 )
+                       == get_global_state2()["total_producer_votepay_share"].as_double() );
+   BOOST_TEST_REQUIRE( total_votes == get_global_state3()["total_vpay_share_change_rate"].as_double() );
    BOOST_REQUIRE_EQUAL( cur_info2_emily["last_votepay_share_update"].as_string(),
                         get_global_state3()["last_vpay_state_update"].as_string() );
 
@@ -2557,10 +2836,9 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_proxy, eosio_system_tester, * boost::unit_
 
    // bob chooses alice as proxy
    // emily still hasn't claimed rewards
-   last_update_time = microseconds_since_epoch_of_iso_string( get_producer_info2(carol)["last_votepay_share_update"] );
    BOOST_REQUIRE_EQUAL( success(), vote( bob, { }, alice ) );
-   cur_info2 = get_producer_info2(carol);
-   cur_info2_emily = get_producer_info2(emily);
+   cur_info2 = get_producer_votepay_state(carol);
+   cur_info2_emily = get_producer_votepay_state(emily);
 
    expected_votepay_share += double( (microseconds_since_epoch_of_iso_string( cur_info2["last_votepay_share_update"] ) - last_update_time) / 1E6 ) * total_votes;
    BOOST_TEST_REQUIRE( expected_votepay_share == cur_info2["votepay_share"].as_double() );
@@ -2630,9 +2908,9 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_update_order, eosio_system_tester, * boost
    }
 
    const auto& carol_info  = get_producer_info(carol);
-   const auto& carol_info2 = get_producer_info2(carol);
+   const auto& carol_info2 = get_producer_votepay_state(carol);
    const auto& emily_info  = get_producer_info(emily);
-   const auto& emily_info2 = get_producer_info2(emily);
+   const auto& emily_info2 = get_producer_votepay_state(emily);
    const auto& gs3         = get_global_state3();
    BOOST_REQUIRE_EQUAL( carol_info2["last_votepay_share_update"].as_string(), gs3["last_vpay_state_update"].as_string() );
    BOOST_REQUIRE_EQUAL( emily_info2["last_votepay_share_update"].as_string(), gs3["last_vpay_state_update"].as_string() );
@@ -2644,6 +2922,64 @@ BOOST_FIXTURE_TEST_CASE(votepay_share_update_order, eosio_system_tester, * boost
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(revote_skips_unchanged_producers, eosio_system_tester, * boost::unit_test::tolerance(1e-10)) try {
+
+   cross_15_percent_threshold();
+
+   const asset net = core_sym::from_string("80.0000");
+   const asset cpu = core_sym::from_string("80.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n, "emilyaccount"_n };
+   for (const auto& a: accounts) {
+      create_account_with_resources( a, config::system_account_name, core_sym::from_string("1.0000"), false, net, cpu );
+      transfer( config::system_account_name, a, core_sym::from_string("1000.0000"), config::system_account_name );
+   }
+   const auto alice = accounts[0];
+   const auto bob   = accounts[1];
+   const auto carol = accounts[2];
+   const auto emily = accounts[3];
+
+   BOOST_REQUIRE_EQUAL( success(), regproducer( bob ) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( carol ) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( emily ) );
+
+   BOOST_REQUIRE_EQUAL( success(), stake( alice, core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( alice, { bob, carol } ) );
+   const double vote_weight = get_voter_info(alice)["last_vote_weight"].as_double();
+   const auto bob_update    = get_producer_votepay_state(bob)["last_votepay_share_update"].as_string();
+   const auto carol_update  = get_producer_votepay_state(carol)["last_votepay_share_update"].as_string();
+
+   produce_block();
+
+   // adding a producer only updates the added producer as long as the vote weight is unchanged
+   BOOST_REQUIRE_EQUAL( success(), vote( alice, { bob, carol, emily } ) );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_voter_info(alice)["last_vote_weight"].as_double() );
+   BOOST_REQUIRE_EQUAL( bob_update,   get_producer_votepay_state(bob)["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( carol_update, get_producer_votepay_state(carol)["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( get_producer_votepay_state(emily)["last_votepay_share_update"].as_string(),
+                        get_global_state3()["last_vpay_state_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_producer_info(bob)["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_producer_info(carol)["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_producer_info(emily)["total_votes"].as_double() );
+
+   produce_block();
+
+   // dropping a producer only updates the dropped producer
+   BOOST_REQUIRE_EQUAL( success(), vote( alice, { carol, emily } ) );
+   BOOST_REQUIRE_EQUAL( get_producer_votepay_state(bob)["last_votepay_share_update"].as_string(),
+                        get_global_state3()["last_vpay_state_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( carol_update, get_producer_votepay_state(carol)["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( 0.0, get_producer_info(bob)["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_producer_info(carol)["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( vote_weight, get_producer_info(emily)["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( 2 * vote_weight == get_global_state()["total_producer_vote_weight"].as_double() );
+
+   // producers that are not (or no longer) registered are still rejected when voted for again
+   BOOST_REQUIRE_EQUAL( success(), push_action( carol, "unregprod"_n, mvo()("producer", carol) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg( "producer carolaccount is not currently registered" ),
+                        vote( alice, { carol, emily } ) );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(votepay_transition, eosio_system_tester, * boost::unit_test::tolerance(1e-10)) try {
 
    const asset net = core_sym::from_string("80.0000");
@@ -2655,6 +2991,10 @@ BOOST_FIXTURE_TEST_CASE(votepay_transition, eosio_system_tester, * boost::unit_t
       BOOST_REQUIRE_EQUAL(success(), stake(v, core_sym::from_string("30000000.0000"), core_sym::from_string("30000000.0000")) );
    }
 
+   // producers registered by a contract older than 3.11.0 have their votepay share in the producers2 table
+   set_code( config::system_account_name, contracts::util::system_wasm_v1_8() );
+   set_abi(  config::system_account_name, contracts::util::system_abi_v1_8().data() );
+
    // create accounts {defproducera, defproducerb, ..., defproducerz} and register as producers
    std::vector<account_name> producer_names;
    {
@@ -2690,6 +3030,10 @@ BOOST_FIXTURE_TEST_CASE(votepay_transition, eosio_system_tester, * boost::unit_t
                                      "producers2"_n ) );
    BOOST_REQUIRE( !tbl );
 
+   set_code( config::system_account_name, contracts::system_wasm() );
+   set_abi(  config::system_account_name, contracts::system_abi().data() );
+   produce_block();
+
    BOOST_REQUIRE_EQUAL( success(), vote("producvoterb"_n, vector<account_name>(producer_names.begin(), producer_names.end())) );
    tbl = control->db().find<eosio::chain::table_id_object, eosio::chain::by_code_scope_table>(
             boost::make_tuple( config::system_account_name,
@@ -2697,13 +3041,96 @@ BOOST_FIXTURE_TEST_CASE(votepay_transition, eosio_system_tester, * boost::unit_t
                                "producers2"_n ) );
    BOOST_REQUIRE( !tbl );
    BOOST_REQUIRE_EQUAL( success(), regproducer("defproducera"_n) );
-   BOOST_REQUIRE( microseconds_since_epoch_of_iso_string( get_producer_info("defproducera"_n)["last_claim_time"] ) < microseconds_since_epoch_of_iso_string( get_producer_info2("defproducera"_n)["last_votepay_share_update"] ) );
+   BOOST_REQUIRE( microseconds_since_epoch_of_iso_string( get_producer_info("defproducera"_n)["last_claim_time"] ) < microseconds_since_epoch_of_iso_string( get_producer_votepay_state("defproducera"_n)["last_votepay_share_update"] ) );
 
    create_account_with_resources( "defproducer1"_n, config::system_account_name, core_sym::from_string("1.0000"), false, net, cpu );
    BOOST_REQUIRE_EQUAL( success(), regproducer("defproducer1"_n) );
    BOOST_REQUIRE( 0 < microseconds_since_epoch_of_iso_string( get_producer_info("defproducer1"_n)["last_claim_time"] ) );
    BOOST_REQUIRE_EQUAL( get_producer_info("defproducer1"_n)["last_claim_time"].as_string(),
-                        get_producer_info2("defproducer1"_n)["last_votepay_share_update"].as_string() );
+                        get_producer_votepay_state("defproducer1"_n)["last_votepay_share_update"].as_string() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(votepay_producers2_migration, eosio_system_tester, * boost::unit_test::tolerance(1e-10)) try {
+
+   const asset net = core_sym::from_string("80.0000");
+   const asset cpu = core_sym::from_string("80.0000");
+   const std::vector<account_name> voters = { "producvotera"_n, "producvoterb"_n, "producvoterc"_n, "producvoterd"_n };
+   for (const auto& v: voters) {
+      create_account_with_resources( v, config::system_account_name, core_sym::from_string("1.0000"), false, net, cpu );
+      transfer( config::system_account_name, v, core_sym::from_string("100000000.0000"), config::system_account_name );
+      BOOST_REQUIRE_EQUAL(success(), stake(v, core_sym::from_string("30000000.0000"), core_sym::from_string("30000000.0000")) );
+   }
+
+   // producers registered by a contract older than 3.11.0 have their votepay share in the producers2 table
+   set_code( config::system_account_name, contracts::util::system_wasm_v1_8() );
+   set_abi(  config::system_account_name, contracts::util::system_abi_v1_8().data() );
+
+   const std::vector<account_name> producer_names = { "defproducera"_n, "defproducerb"_n, "defproducerc"_n };
+   setup_producer_accounts(producer_names);
+   for (const auto& p: producer_names) {
+      BOOST_REQUIRE_EQUAL( success(), regproducer(p) );
+   }
+   BOOST_REQUIRE_EQUAL( success(), vote("producvotera"_n, producer_names) );
+   produce_block( fc::hours(10) );
+   BOOST_REQUIRE_EQUAL( success(), vote("producvoterb"_n, producer_names) );
+   BOOST_REQUIRE( 0 < get_producer_info2("defproducera"_n)["votepay_share"].as_double() );
+
+   set_code( config::system_account_name, contracts::system_wasm() );
+   set_abi(  config::system_account_name, contracts::system_abi().data() );
+   produce_block( fc::hours(1) );
+
+   auto producers2_row = [&]( const account_name& p ) {
+      return get_row_by_account( config::system_account_name, config::system_account_name, "producers2"_n, p );
+   };
+   for (const auto& p: producer_names) {
+      BOOST_REQUIRE( !get_producer_info(p).get_object().contains("votepay_state") );
+      BOOST_REQUIRE( !producers2_row(p).empty() );
+   }
+
+   // until migrated, the votepay share of a producer is still settled in its producers2 row
+   {
+      const auto   init_info2  = get_producer_info2("defproducera"_n);
+      const double init_votes  = get_producer_info("defproducera"_n)["total_votes"].as_double();
+      const uint64_t init_update = microseconds_since_epoch_of_iso_string( init_info2["last_votepay_share_update"] );
+      BOOST_REQUIRE_EQUAL( success(), vote("producvoterc"_n, producer_names) );
+      const auto info2 = get_producer_info2("defproducera"_n);
+      BOOST_REQUIRE_EQUAL( info2["last_votepay_share_update"].as_string(), get_global_state3()["last_vpay_state_update"].as_string() );
+      BOOST_TEST_REQUIRE( init_info2["votepay_share"].as_double()
+                          + double( (microseconds_since_epoch_of_iso_string( info2["last_votepay_share_update"] ) - init_update) / 1E6 ) * init_votes
+                          == info2["votepay_share"].as_double() );
+      BOOST_REQUIRE( !get_producer_info("defproducera"_n).get_object().contains("votepay_state") );
+   }
+
+   // regproducer moves the votepay share into the producers row as is and erases the producers2 row
+   {
+      const auto info2 = get_producer_info2("defproducera"_n);
+      BOOST_REQUIRE_EQUAL( success(), regproducer("defproducera"_n) );
+      BOOST_REQUIRE( producers2_row("defproducera"_n).empty() );
+      const auto votepay_state = get_producer_info("defproducera"_n)["votepay_state"];
+      BOOST_TEST_REQUIRE( info2["votepay_share"].as_double() == votepay_state["votepay_share"].as_double() );
+      BOOST_REQUIRE_EQUAL( info2["last_votepay_share_update"].as_string(), votepay_state["last_votepay_share_update"].as_string() );
+      BOOST_REQUIRE( !producers2_row("defproducerb"_n).empty() );
+   }
+
+   // claimrewards migrates the votepay share, resetting it as the claim pays it out
+   produce_block( fc::hours(14) );
+   BOOST_REQUIRE_EQUAL( success(), push_action("defproducerb"_n, "claimrewards"_n, mvo()("owner", "defproducerb")) );
+   BOOST_REQUIRE( producers2_row("defproducerb"_n).empty() );
+   {
+      const auto prod = get_producer_info("defproducerb"_n);
+      BOOST_TEST_REQUIRE( 0 == prod["votepay_state"]["votepay_share"].as_double() );
+      BOOST_REQUIRE_EQUAL( prod["last_claim_time"].as_string(), prod["votepay_state"]["last_votepay_share_update"].as_string() );
+   }
+
+   // migrated producers are settled in their producers row, the others still in their producers2 row
+   BOOST_REQUIRE_EQUAL( success(), vote("producvoterd"_n, producer_names) );
+   const auto last_vpay_state_update = get_global_state3()["last_vpay_state_update"].as_string();
+   BOOST_REQUIRE_EQUAL( last_vpay_state_update, get_producer_info("defproducera"_n)["votepay_state"]["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( last_vpay_state_update, get_producer_info("defproducerb"_n)["votepay_state"]["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( last_vpay_state_update, get_producer_info2("defproducerc"_n)["last_votepay_share_update"].as_string() );
+   BOOST_REQUIRE( producers2_row("defproducera"_n).empty() );
+   BOOST_REQUIRE( producers2_row("defproducerb"_n).empty() );
 
 } FC_LOG_AND_RETHROW()
 
@@ -3944,6 +4371,89 @@ BOOST_FIXTURE_TEST_CASE( ram_gift, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( global_state_written_only_when_modified, eosio_system_tester ) try {
+   const std::vector<name> global_tables{ "global"_n, "global2"_n, "global3"_n, "global4"_n };
+   auto& db = control->mutable_db();
+
+   auto find_row = [&]( name table ) -> const key_value_object& {
+      const auto* tbl = db.find<table_id_object, by_code_scope_table>(
+         boost::make_tuple( config::system_account_name, config::system_account_name, table ) );
+      BOOST_REQUIRE( tbl );
+      const auto* obj = db.find<key_value_object, by_scope_primary>( boost::make_tuple( tbl->id, table.to_uint64_t() ) );
+      BOOST_REQUIRE( obj );
+      return *obj;
+   };
+
+   // Appends a marker byte to the global state rows behind the contract's back. Reading a singleton ignores trailing
+   // bytes, but writing a row back drops the marker and shrinks the row by one byte, which shows up as a RAM delta.
+   const char marker = 0x5a;
+   auto mark_rows = [&]() {
+      for( auto table : global_tables ) {
+         const auto& row = find_row( table );
+         std::string value( row.value.data(), row.value.size() );
+         value.push_back( marker );
+         db.modify( row, [&]( key_value_object& o ) { o.value.assign( value.data(), value.size() ); } );
+      }
+   };
+   auto is_marked = [&]( name table ) {
+      const auto& row = find_row( table );
+      return row.value.size() > 0 && row.value.data()[row.value.size() - 1] == marker;
+   };
+   auto unmark_rows = [&]() {
+      for( auto table : global_tables ) {
+         if( !is_marked( table ) )
+            continue;
+         const auto& row = find_row( table );
+         std::string value( row.value.data(), row.value.size() - 1 );
+         db.modify( row, [&]( key_value_object& o ) { o.value.assign( value.data(), value.size() ); } );
+      }
+   };
+   auto system_ram_delta = []( const transaction_trace_ptr& trace ) {
+      int64_t delta = 0;
+      for( const auto& at : trace->action_traces )
+         for( const auto& d : at.account_ram_deltas )
+            if( d.account == config::system_account_name )
+               delta += d.delta;
+      return delta;
+   };
+
+   // Actions that do not touch the global state leave all its rows untouched.
+   auto check_untouched = [&]( const transaction_trace_ptr& trace ) {
+      BOOST_REQUIRE( !trace->except );
+      BOOST_REQUIRE_EQUAL( 0, system_ram_delta( trace ) );
+      for( auto table : global_tables )
+         BOOST_REQUIRE( is_marked( table ) );
+   };
+
+   mark_rows();
+   check_untouched( base_tester::push_action( config::system_account_name, "regproxy"_n, "alice1111111"_n,
+                                              mvo()("proxy", "alice1111111")("isproxy", true) ) );
+   check_untouched( base_tester::push_action( config::system_account_name, "logsystemfee"_n, config::system_account_name,
+                                              mvo()("protocol", "eosio.ram")("fee", core_sym::from_string("1.0000"))("memo", "") ) );
+   // setpayfactor reads global4, but leaves it unchanged when given the current factors.
+   check_untouched( base_tester::push_action( config::system_account_name, "setpayfactor"_n, config::system_account_name,
+                                              mvo()("inflation_pay_factor", get_global_state4()["inflation_pay_factor"])
+                                                   ("votepay_factor", get_global_state4()["votepay_factor"]) ) );
+   unmark_rows();
+   produce_block();
+
+   // An action modifying the global state writes back only the rows it changed.
+   mark_rows();
+   auto trace = base_tester::push_action( config::system_account_name, "setpayfactor"_n, config::system_account_name,
+                                          mvo()("inflation_pay_factor", 60000)("votepay_factor", 30000) );
+   BOOST_REQUIRE( !trace->except );
+   BOOST_REQUIRE_EQUAL( -1, system_ram_delta( trace ) );
+   BOOST_REQUIRE( is_marked( "global"_n ) );
+   BOOST_REQUIRE( is_marked( "global2"_n ) );
+   BOOST_REQUIRE( is_marked( "global3"_n ) );
+   BOOST_REQUIRE( !is_marked( "global4"_n ) );
+   unmark_rows();
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL( 60000, get_global_state4()["inflation_pay_factor"].as_int64() );
+   BOOST_REQUIRE_EQUAL( 30000, get_global_state4()["votepay_factor"].as_int64() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE(eosio_system_origin_rex_tests)
 
@@ -4314,11 +4824,17 @@ BOOST_FIXTURE_TEST_CASE( buy_rent_rex, eosio_system_tester ) try {
    const int64_t init_cpu_limit = get_cpu_limit( alice );
    const int64_t init_net_limit = get_net_limit( alice );
 
+   // core symbol and REX status are kept in the `sysstatus` singleton
+   BOOST_REQUIRE_EQUAL( symbol{CORE_SYM}, get_system_status()["core_symbol"].as<symbol>() );
+   BOOST_REQUIRE_EQUAL( false,            get_system_status()["rex_initialized"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( false,            get_system_status()["rex_available"].as<bool>() );
    // bob tries to rent rex
    BOOST_REQUIRE_EQUAL( wasm_assert_msg("rex system not initialized yet"), rentcpu( bob, carol, core_sym::from_string("5.0000") ) );
    // alice lends rex
    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("50265.0000") ) );
    BOOST_REQUIRE_EQUAL( init_balance - core_sym::from_string("50265.0000"), get_rex_fund(alice) );
+   BOOST_REQUIRE_EQUAL( true,      get_system_status()["rex_initialized"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( true,      get_system_status()["rex_available"].as<bool>() );
    auto rex_pool = get_rex_pool();
    const asset   init_tot_unlent   = rex_pool["total_unlent"].as<asset>();
    const asset   init_tot_lendable = rex_pool["total_lendable"].as<asset>();
@@ -4383,12 +4899,15 @@ BOOST_FIXTURE_TEST_CASE( buy_rent_rex, eosio_system_tester ) try {
       BOOST_REQUIRE_EQUAL( 0, rex_pool["total_lendable"].as<asset>().get_amount() );
       BOOST_REQUIRE_EQUAL( 0, rex_pool["total_unlent"].as<asset>().get_amount() );
       BOOST_REQUIRE_EQUAL( 0, rex_pool["total_rex"].as<asset>().get_amount() );
+      BOOST_REQUIRE_EQUAL( true,  get_system_status()["rex_initialized"].as<bool>() );
+      BOOST_REQUIRE_EQUAL( false, get_system_status()["rex_available"].as<bool>() );
    }
 
    {
       const int64_t init_net_limit = get_net_limit( emily );
       BOOST_REQUIRE_EQUAL( 0,         get_rex_balance(alice).get_amount() );
       BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("20050.0000") ) );
+      BOOST_REQUIRE_EQUAL( true,      get_system_status()["rex_available"].as<bool>() );
       rex_pool = get_rex_pool();
       const asset fee = core_sym::from_string("0.4560");
       int64_t expected_net = bancor_convert( rex_pool["total_rent"].as<asset>().get_amount(),
@@ -4602,6 +5121,13 @@ BOOST_FIXTURE_TEST_CASE( buy_sell_claim_rex, eosio_system_tester ) try {
       BOOST_REQUIRE_EQUAL( false,          get_rex_order_obj(alice).is_null() );
       BOOST_REQUIRE_EQUAL( false,          get_rex_order(alice)["is_open"].as<bool>() );
 
+      // any account can settle alice's filled order, crediting its proceeds to her REX fund
+      const asset alice_proceeds = get_rex_order(alice)["proceeds"].as<asset>();
+      const asset alice_rex_fund = get_rex_fund(alice);
+      BOOST_REQUIRE_EQUAL( success(),                       rexsettle( frank, 10 ) );
+      BOOST_REQUIRE_EQUAL( true,                            get_rex_order_obj(alice).is_null() );
+      BOOST_REQUIRE_EQUAL( alice_rex_fund + alice_proceeds, get_rex_fund(alice) );
+
       BOOST_REQUIRE_EQUAL( success(),      rentcpu( frank, frank, core_sym::from_string("1.0000") ) );
    }
 
@@ -4777,6 +5303,137 @@ BOOST_FIXTURE_TEST_CASE( rex_loan_checks, eosio_system_tester ) try {
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( rex_maintenance_due, eosio_system_tester ) try {
+
+   const asset   init_balance = core_sym::from_string("40000.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1];
+   setup_rex_accounts( accounts, init_balance );
+
+   auto next_due = [&]() { return get_rex_maintenance()["next_due"].as<fc::time_point_sec>(); };
+   auto head_time = [&]() { return fc::time_point_sec( control->pending_block_time() - fc::milliseconds(config::block_interval_ms) ); };
+
+   // REX actions record when maintenance is next due, and skip it until then
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("25000.0000") ) );
+   BOOST_REQUIRE( head_time() < next_due() );
+
+   // renting a loan makes maintenance due no later than the loan expiration
+   BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("30.0000") ) );
+   const auto expiration = get_cpu_loan(1)["expiration"].as<fc::time_point>();
+   BOOST_REQUIRE( head_time() < next_due() );
+   BOOST_REQUIRE( next_due() <= fc::time_point_sec( expiration ) );
+
+   // once the loan has expired, the next REX action processes it
+   produce_block( fc::days(31) );
+   BOOST_REQUIRE( next_due() <= head_time() );
+   BOOST_REQUIRE_EQUAL( success(), updaterex( alice ) );
+   BOOST_REQUIRE( get_cpu_loan(1).is_null() );
+   BOOST_REQUIRE( head_time() < next_due() );
+
+} FC_LOG_AND_RETHROW()
+
+
+BOOST_FIXTURE_TEST_CASE( rex_maintenance_block_budget, eosio_system_tester ) try {
+
+   const asset   init_balance = core_sym::from_string("40000.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1];
+   setup_rex_accounts( accounts, init_balance );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("25000.0000") ) );
+
+   // more loans than the 12 loans and sellrex orders REX actions process per block
+   const uint64_t num_loans = 16;
+   for ( uint64_t i = 0; i < num_loans / 2; ++i ) {
+      BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("10.0000") ) );
+      BOOST_REQUIRE_EQUAL( success(), rentnet( bob, bob, core_sym::from_string("10.0000") ) );
+   }
+   auto open_loans = [&]() {
+      uint64_t n = 0;
+      for ( uint64_t loan_num = 1; loan_num <= num_loans; ++loan_num ) {
+         n += !get_cpu_loan( loan_num ).is_null() || !get_net_loan( loan_num ).is_null();
+      }
+      return n;
+   };
+   BOOST_REQUIRE_EQUAL( num_loans, open_loans() );
+
+   // REX actions pushed in the same block, each processing up to 2 CPU and 2 NET loans out of the remaining budget
+   auto updaterex_in_pending_block = [&]( uint32_t count ) {
+      for ( uint32_t i = 0; i < count; ++i ) {
+         base_tester::push_action( config::system_account_name, "updaterex"_n, alice, mvo()("owner", alice),
+                                   DEFAULT_EXPIRATION_DELTA + i );
+      }
+   };
+
+   // once all loans have expired, five REX actions in one block process 4 + 4 + 2 loans, then exhaust the budget
+   produce_block( fc::days(31) );
+   updaterex_in_pending_block( 5 );
+   BOOST_REQUIRE_EQUAL( num_loans - 10, open_loans() );
+   auto maint = get_rex_maintenance();
+   BOOST_REQUIRE_EQUAL( 10, maint["budget_used"].as<uint16_t>() );
+   BOOST_REQUIRE( maint["next_due"].as<fc::time_point_sec>() <= fc::time_point_sec( control->pending_block_time() ) );
+
+   // the budget is available again in the next block
+   produce_block();
+   updaterex_in_pending_block( 1 );
+   BOOST_REQUIRE_EQUAL( num_loans - 14, open_loans() );
+   BOOST_REQUIRE_EQUAL( 4, get_rex_maintenance()["budget_used"].as<uint16_t>() );
+
+   // rexexec is not limited by the budget
+   produce_block();
+   BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 16 ) );
+   BOOST_REQUIRE_EQUAL( 0, open_loans() );
+   maint = get_rex_maintenance();
+   BOOST_REQUIRE_EQUAL( 4, maint["budget_used"].as<uint16_t>() );
+
+   // maintenance that processes no loan or order leaves the budget, and the block it was charged in, unchanged
+   produce_block( fc::minutes(11) );
+   BOOST_REQUIRE( maint["next_due"].as<fc::time_point_sec>() <= fc::time_point_sec( control->pending_block_time() ) );
+   BOOST_REQUIRE_EQUAL( success(), updaterex( alice ) );
+   BOOST_REQUIRE_EQUAL( maint["budget_block"].as_string(), get_rex_maintenance()["budget_block"].as_string() );
+   BOOST_REQUIRE_EQUAL( 4, get_rex_maintenance()["budget_used"].as<uint16_t>() );
+
+} FC_LOG_AND_RETHROW()
+
+
+BOOST_FIXTURE_TEST_CASE( rex_loans_bulk_settlement, eosio_system_tester ) try {
+
+   const asset   init_balance = core_sym::from_string("40000.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1], carol = accounts[2];
+   setup_rex_accounts( accounts, init_balance );
+
+   auto weights = [&]( const account_name& a ) {
+      auto total = get_total_stake( a );
+      return std::make_pair( total["net_weight"].as<asset>(), total["cpu_weight"].as<asset>() );
+   };
+   const auto init_bob_weights   = weights( bob );
+   const auto init_carol_weights = weights( carol );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("25000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), rentcpu( alice, bob, core_sym::from_string("30.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), rentcpu( alice, bob, core_sym::from_string("30.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), rentnet( alice, bob, core_sym::from_string("30.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), rentcpu( alice, carol, core_sym::from_string("30.0000") ) );
+   BOOST_REQUIRE( init_bob_weights.first < weights( bob ).first );
+   BOOST_REQUIRE( init_bob_weights.second < weights( bob ).second );
+   BOOST_REQUIRE( init_carol_weights.second < weights( carol ).second );
+
+   // all expired loans are settled together, and each receiver ends up with the stake it had before renting
+   produce_block( fc::days(31) );
+   BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 10 ) );
+   for ( uint64_t loan_num = 1; loan_num <= 4; ++loan_num ) {
+      BOOST_REQUIRE( get_cpu_loan( loan_num ).is_null() );
+      BOOST_REQUIRE( get_net_loan( loan_num ).is_null() );
+   }
+   BOOST_REQUIRE( init_bob_weights == weights( bob ) );
+   BOOST_REQUIRE( init_carol_weights == weights( carol ) );
+   BOOST_REQUIRE_EQUAL( weights( bob ).first.get_amount(),  get_net_limit( bob ) );
+   BOOST_REQUIRE_EQUAL( weights( bob ).second.get_amount(), get_cpu_limit( bob ) );
+
+} FC_LOG_AND_RETHROW()
+
+
 BOOST_FIXTURE_TEST_CASE( ramfee_namebid_to_rex, eosio_system_tester ) try {
 
    const asset   init_balance = core_sym::from_string("10000.0000");
@@ -4868,6 +5525,9 @@ BOOST_FIXTURE_TEST_CASE( rex_maturity, eosio_system_tester ) try {
       BOOST_REQUIRE_EQUAL( 550000 * rex_ratio, rex_balance["rex_balance"].as<asset>().get_amount() );
       BOOST_REQUIRE_EQUAL( 0,                  rex_balance["matured_rex"].as<int64_t>() );
       BOOST_REQUIRE_EQUAL( 2,                  rex_balance["rex_maturities"].get_array().size() );
+      // one maturity bucket per day of the default 5-day maturity period
+      BOOST_REQUIRE_EQUAL( 1,                  rex_balance["version"].as<uint8_t>() );
+      BOOST_REQUIRE_EQUAL( 5,                  rex_balance["maturity_days"]["maturing"].get_array().size() );
 
       BOOST_REQUIRE_EQUAL( wasm_assert_msg("insufficient available rex"),
                            sellrex( alice, asset::from_string("115000.0000 REX") ) );
@@ -5826,6 +6486,140 @@ BOOST_FIXTURE_TEST_CASE( rex_return, eosio_system_tester ) try {
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( rex_return_accrual_equivalence, eosio_system_tester ) try {
+
+   // reference model of the return pool accrual as implemented with the rex_return_buckets table: buckets are kept
+   // in a sorted vector and expired ones are removed by a linear scan
+   struct rex_return_model {
+      static constexpr uint32_t total_intervals = 30 * 144;
+      static constexpr uint32_t dist_interval   = 10 * 60;
+      static constexpr uint32_t bucket_interval = 12 * 3600;
+      static constexpr uint32_t no_bucket       = std::numeric_limits<uint32_t>::max();
+
+      bool     exists                   = false;
+      uint32_t last_dist_time           = 0;
+      uint32_t pending_bucket_time      = no_bucket;
+      uint32_t oldest_bucket_time       = 0;
+      int64_t  pending_bucket_proceeds  = 0;
+      int64_t  current_rate_of_increase = 0;
+      int64_t  proceeds                 = 0;
+      int64_t  distributed              = 0;
+      std::vector<std::pair<uint32_t, int64_t>> buckets;
+
+      static uint32_t elapsed_intervals( uint32_t t1, uint32_t t0 ) { return ( t1 - t0 ) / dist_interval; }
+
+      void update( uint32_t now ) {
+         const uint32_t effective_time = now - now % dist_interval;
+         if ( !exists || effective_time <= last_dist_time ) {
+            return;
+         }
+         int64_t change_estimate = current_rate_of_increase * elapsed_intervals( effective_time, last_dist_time );
+         if ( pending_bucket_time <= effective_time ) {
+            const int64_t remainder = pending_bucket_proceeds % total_intervals;
+            const int64_t rate      = ( pending_bucket_proceeds - remainder ) / total_intervals;
+            current_rate_of_increase += rate;
+            change_estimate          += remainder + rate * elapsed_intervals( effective_time, pending_bucket_time );
+            auto iter = std::lower_bound( buckets.begin(), buckets.end(), pending_bucket_time,
+                                          []( const auto& bucket, uint32_t t ) { return bucket.first < t; } );
+            if ( iter != buckets.end() && iter->first == pending_bucket_time ) {
+               iter->second = rate;
+            } else {
+               buckets.insert( iter, { pending_bucket_time, rate } );
+            }
+            oldest_bucket_time      = std::min( oldest_bucket_time, pending_bucket_time );
+            pending_bucket_proceeds = 0;
+            pending_bucket_time     = no_bucket;
+         }
+         proceeds      -= change_estimate;
+         last_dist_time = effective_time;
+
+         const uint32_t time_threshold = effective_time - total_intervals * dist_interval;
+         if ( oldest_bucket_time <= time_threshold ) {
+            auto iter = buckets.begin();
+            for ( ; iter != buckets.end() && iter->first <= time_threshold; ++iter ) {
+               const int64_t surplus = iter->second * elapsed_intervals( effective_time, iter->first + total_intervals * dist_interval );
+               current_rate_of_increase -= iter->second;
+               change_estimate          -= surplus;
+               proceeds                 += surplus;
+            }
+            buckets.erase( buckets.begin(), iter );
+            oldest_bucket_time = buckets.empty() ? 0 : buckets.front().first;
+         }
+
+         if ( change_estimate > 0 && proceeds < 0 ) {
+            change_estimate += proceeds;
+            proceeds         = 0;
+         }
+         if ( change_estimate > 0 ) {
+            distributed += change_estimate;
+         }
+      }
+
+      void donate( uint32_t now, int64_t amount ) {
+         update( now );
+         const uint32_t effective_time = now - now % bucket_interval + bucket_interval;
+         pending_bucket_proceeds += amount;
+         proceeds                += amount;
+         if ( !exists ) {
+            exists         = true;
+            last_dist_time = effective_time;
+         }
+         if ( pending_bucket_time == no_bucket ) {
+            pending_bucket_time = effective_time;
+         }
+      }
+   };
+
+   const asset init_balance = core_sym::from_string("100000.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1];
+   setup_rex_accounts( accounts, init_balance, core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+   BOOST_REQUIRE_EQUAL( success(), deposit( alice, core_sym::from_string("1000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("1000.0000") ) );
+   const int64_t init_lendable = get_rex_pool()["total_lendable"].as<asset>().get_amount();
+
+   auto pending_time = [&]() { return fc::time_point_sec( control->pending_block_time() ).sec_since_epoch(); };
+   auto check_equivalence = [&]( const rex_return_model& model ) {
+      const auto pool = get_rex_return_pool();
+      BOOST_REQUIRE_EQUAL( model.last_dist_time,           pool["last_dist_time"].as<time_point_sec>().sec_since_epoch() );
+      BOOST_REQUIRE_EQUAL( model.pending_bucket_time,      pool["pending_bucket_time"].as<time_point_sec>().sec_since_epoch() );
+      BOOST_REQUIRE_EQUAL( model.oldest_bucket_time,       pool["oldest_bucket_time"].as<time_point_sec>().sec_since_epoch() );
+      BOOST_REQUIRE_EQUAL( model.pending_bucket_proceeds,  pool["pending_bucket_proceeds"].as<int64_t>() );
+      BOOST_REQUIRE_EQUAL( model.current_rate_of_increase, pool["current_rate_of_increase"].as<int64_t>() );
+      BOOST_REQUIRE_EQUAL( model.proceeds,                 pool["proceeds"].as<int64_t>() );
+      BOOST_REQUIRE_EQUAL( init_lendable + model.distributed, get_rex_pool()["total_lendable"].as<asset>().get_amount() );
+
+      const auto& buckets = get_rex_return_buckets()["return_buckets"].get_array();
+      BOOST_REQUIRE_EQUAL( model.buckets.size(), buckets.size() );
+      for ( size_t i = 0; i < buckets.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( model.buckets[i].first,  buckets[i]["first"].as<time_point_sec>().sec_since_epoch() );
+         BOOST_REQUIRE_EQUAL( model.buckets[i].second, buckets[i]["second"].as<int64_t>() );
+      }
+   };
+
+   // randomized donation histories, with gaps from a few seconds to more than the 30-day return window, must leave
+   // the return pool and the REX pool exactly as the reference model does
+   std::mt19937 rng( 20240611 );
+   const std::vector<uint32_t> max_gaps = { 60, 3600, 12 * 3600, 3 * 24 * 3600, 40 * 24 * 3600 };
+   rex_return_model model;
+   for ( int i = 0; i < 200; ++i ) {
+      const uint32_t max_gap = max_gaps[ std::uniform_int_distribution<size_t>( 0, max_gaps.size() - 1 )( rng ) ];
+      produce_block( fc::seconds( std::uniform_int_distribution<uint32_t>( 0, max_gap )( rng ) ) );
+
+      const uint32_t now = pending_time();
+      if ( !model.exists || std::uniform_int_distribution<int>( 0, 2 )( rng ) != 0 ) {
+         const int64_t amount = std::uniform_int_distribution<int64_t>( 1, 100'0000 )( rng );
+         BOOST_REQUIRE_EQUAL( success(), donatetorex( bob, asset( amount, symbol{CORE_SYM} ), "" ) );
+         model.donate( now, amount );
+      } else {
+         BOOST_REQUIRE_EQUAL( success(), updaterex( alice ) );
+         model.update( now );
+      }
+      check_equivalence( model );
+   }
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_CASE( setabi_bios ) try {
    fc::temp_directory tempdir;
    validating_tester t( tempdir, true );
@@ -6046,6 +6840,85 @@ auto cat(Vs&&... vs) {
     return res;
 }
 
+// scalar matcher the SWAR `found_in` and `canon_name_positions::contains` replaced: compare the pattern with
+// account_name at every position in turn
+bool scalar_name_allowed(eosiosystem::canon_name_t account_name, eosiosystem::canon_name_t pattern) {
+   if (!pattern.valid() || pattern.is_suffix_of(account_name) || pattern.size() > account_name.size())
+      return true;
+   for (uint64_t i = 0; i + pattern.size() <= account_name.size(); ++i)
+      if (((pattern._value ^ (account_name._value >> (5 * i))) & pattern.mask()) == 0)
+         return false;
+   return true;
+}
+
+// random name of 1 to `max_size` characters drawn from the first `alphabet` characters (`.` being character 0). Small
+// alphabets make matches frequent.
+uint64_t random_name_value(std::mt19937_64& rng, uint64_t max_size, uint64_t alphabet) {
+   const uint64_t size = std::uniform_int_distribution<uint64_t>(1, max_size)(rng);
+   std::uniform_int_distribution<uint64_t> character(0, alphabet - 1);
+   uint64_t v = 0;
+   for (uint64_t i = 0; i < size; ++i)
+      v |= character(rng) << (64 - 5 * (i + 1));
+   return v;
+}
+
+BOOST_AUTO_TEST_CASE( swar_name_matching ) try {
+   using eosiosystem::canon_name_t;
+   using eosiosystem::canon_name_positions;
+
+   std::mt19937_64 rng(0x5eed);
+   std::vector<std::pair<canon_name_t, canon_name_t>> pairs;
+   for (uint64_t alphabet : { 2, 3, 5, 32 }) {
+      for (int i = 0; i < 50'000; ++i) {
+         canon_name_t account_name(random_name_value(rng, 12, alphabet));
+         canon_name_t pattern(random_name_value(rng, 6, alphabet));
+         if (!account_name.valid())
+            continue;
+         pairs.emplace_back(account_name, pattern);
+      }
+   }
+
+   size_t disallowed = 0;
+   for (const auto& [account_name, pattern] : pairs) {
+      const bool expected = scalar_name_allowed(account_name, pattern);
+      disallowed += !expected;
+      BOOST_REQUIRE_MESSAGE(eosiosystem::name_allowed(account_name, pattern) == expected,
+                            std::hex << "account " << account_name._value << " pattern " << pattern._value);
+      BOOST_REQUIRE_MESSAGE(eosiosystem::name_allowed(canon_name_positions(account_name), pattern) == expected,
+                            std::hex << "account " << account_name._value << " pattern " << pattern._value);
+   }
+   BOOST_REQUIRE(disallowed > pairs.size() / 10); // matches are actually exercised
+
+   // microbenchmark, logged only: one account name checked against a denylist of patterns, as in `newaccount`
+   auto time = [&](auto&& allowed) {
+      size_t count = 0;
+      auto   start = std::chrono::steady_clock::now();
+      for (int round = 0; round < 10; ++round)
+         for (size_t i = 0; i + 100 <= pairs.size(); i += 100) {
+            const canon_name_t account_name = pairs[i].first;
+            count += allowed(account_name, i);
+         }
+      auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+      return std::pair{elapsed.count(), count};
+   };
+   auto [scalar_us, scalar_count] = time([&](canon_name_t account_name, size_t first) {
+      size_t count = 0;
+      for (size_t j = first; j < first + 100; ++j)
+         count += scalar_name_allowed(account_name, pairs[j].second);
+      return count;
+   });
+   auto [swar_us, swar_count] = time([&](canon_name_t account_name, size_t first) {
+      const canon_name_positions account_positions(account_name);
+      size_t count = 0;
+      for (size_t j = first; j < first + 100; ++j)
+         count += eosiosystem::name_allowed(account_positions, pairs[j].second);
+      return count;
+   });
+   BOOST_REQUIRE_EQUAL(scalar_count, swar_count);
+   BOOST_TEST_MESSAGE("denylist matching of " << pairs.size() * 10 << " patterns: scalar " << scalar_us
+                      << " us, SWAR " << swar_us << " us");
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( restrictions_update, eosio_system_tester ) try {
    const std::vector<account_name> accounts = { "alice"_n };
    create_accounts_with_resources( accounts );
@@ -6071,6 +6944,8 @@ BOOST_FIXTURE_TEST_CASE( restrictions_update, eosio_system_tester ) try {
    BOOST_REQUIRE_EQUAL(denyhashadd("eosio"_n, *hash), success());           // "eosio"_n can add a hash
    BOOST_REQUIRE_EQUAL(denynames(alice, add1), success());                  // and then anyone (alice here) can deny the name patterns
    BOOST_REQUIRE(get_blacklisted_names() == add1);                          // newly added names are present in blacklist
+   BOOST_REQUIRE(!get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 3).empty()); // stored in one shard per pattern size
+   BOOST_REQUIRE(!get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 7).empty());
 
    BOOST_REQUIRE_EQUAL(denynames(alice, {}),
                        error("assertion failure with message: No patterns provided"));
@@ -6114,6 +6989,7 @@ BOOST_FIXTURE_TEST_CASE( restrictions_update, eosio_system_tester ) try {
 
    BOOST_REQUIRE_EQUAL(undenynames("eosio"_n, add2), success());           // removing all remaining names work
    BOOST_REQUIRE(get_blacklisted_names() == std::vector<name>{});
+   BOOST_REQUIRE(get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 5).empty());  // empty shards are erased
 
    BOOST_REQUIRE_EQUAL(denyhashadd("eosio"_n, *denyhashcalc(alice, add2)),
                        success());
@@ -6231,6 +7107,79 @@ BOOST_AUTO_TEST_CASE( restrictions_checking ) try {
    
 } FC_LOG_AND_RETHROW()
 
+// check restrictions with patterns of several sizes, which are grouped by size in the compiled denylist index
+// ------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( restrictions_index_checking ) try {
+   name_restrictions_checker r{"fred"_n};
+
+   std::vector<name> add { "abc"_n, "xy"_n, "zzzz"_n, "abd"_n, "q.r"_n };
+   BOOST_REQUIRE_EQUAL(r.denyhashadd("eosio"_n, *r.denyhashcalc("fred"_n, add)), r.success());
+   BOOST_REQUIRE_EQUAL(r.denynames("fred"_n, add), r.success());
+
+   r.check_disallowed(
+      {
+           "mmmabcmmmmmm"_n
+        ,  "mmmmmmmmmabd"_n
+        ,  "xymmmmmmmmmm"_n
+        ,  "mmzzzzmmmmmm"_n
+      });
+
+   r.check_allowed(
+      {
+           "mmmabemmmmmm"_n
+        ,  "mmmmmmmmmmmx"_n
+        ,  "mmzzzmmmmmmm"_n
+        ,  "mmmmmqrmmmmm"_n
+      });
+
+   // the rule reported is the pattern actually found in the account name
+   auto [allowed, res] = r.check_allowed("mmmmmmmmabdm"_n);
+   BOOST_REQUIRE(!allowed);
+   BOOST_REQUIRE_EQUAL(res, r.error("assertion failure with message: Account name mmmmmmmmabdm creation disallowed by rule: abd"));
+
+   // removing patterns updates the index
+   BOOST_REQUIRE_EQUAL(r.undenynames("eosio"_n, { "abc"_n, "xy"_n }), r.success());
+   r.check_allowed({ "mmmabcmmmmmm"_n, "xymmmmmmmmmm"_n });
+   r.check_disallowed({ "mmmmmmmmmabd"_n, "mmzzzzmmmmmm"_n });
+
+} FC_LOG_AND_RETHROW()
+
+// check the legacy `acctdenylist` row of a chain upgraded from a version before 3.11.0, which `newaccount` checks until
+// `denynames` or `undenynames` moves its patterns into the shards
+// ------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( restrictions_legacy_checking ) try {
+   name_restrictions_checker r{"fred"_n};
+
+   std::vector<name> add { "abc"_n, "xy"_n };
+   BOOST_REQUIRE_EQUAL(r.denyhashadd("eosio"_n, *r.denyhashcalc("fred"_n, add)), r.success());
+   BOOST_REQUIRE_EQUAL(r.denynames("fred"_n, add), r.success());
+
+   r.set_code(config::system_account_name, system_contracts::testing::test_contracts::denylist_legacy_wasm());
+   r.set_abi(config::system_account_name, system_contracts::testing::test_contracts::denylist_legacy_abi().data());
+   r.base_tester::push_action(config::system_account_name, "tolegacy"_n, config::system_account_name, mvo());
+   r.set_code(config::system_account_name, contracts::system_wasm());
+   r.set_abi(config::system_account_name, contracts::system_abi().data());
+   r.produce_block();
+
+   BOOST_REQUIRE(r.get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 2).empty());
+   BOOST_REQUIRE(r.get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 3).empty());
+   BOOST_REQUIRE(r.get_blacklisted_names() == add);                   // only in the legacy row
+
+   r.check_disallowed({ "mmmabcmmmmmm"_n, "xymmmmmmmmmm"_n });
+   r.check_allowed({ "mmmabemmmmmm"_n });
+
+   // `undenynames` migrates the legacy row before removing patterns, and the legacy row is no longer read afterwards
+   BOOST_REQUIRE_EQUAL(r.undenynames("eosio"_n, { "xy"_n }), r.success());
+   BOOST_REQUIRE(r.get_row_by_id("eosio"_n, "eosio"_n, "acctdenylist"_n, 0).empty());
+   BOOST_REQUIRE(!r.get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 3).empty());
+   BOOST_REQUIRE(r.get_row_by_id("eosio"_n, "eosio"_n, "acctdenyshrd"_n, 2).empty());
+   BOOST_REQUIRE(r.get_blacklisted_names() == std::vector<name>{ "abc"_n });
+
+   r.check_disallowed({ "mmmmmmmmmabc"_n });
+   r.check_allowed({ "xymmmmmmmmmm"_n });
+
+} FC_LOG_AND_RETHROW()
+
 // check that "eosio"_n is not subject to account name restrictions and does not need to add a hash
 // ------------------------------------------------------------------------------------------------
 BOOST_AUTO_TEST_CASE( eosio_restrictions_checking ) try {